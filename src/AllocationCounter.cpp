@@ -0,0 +1,99 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace {
+
+std::atomic<std::size_t> counter{ 0 };
+
+void* allocate(const std::size_t size) noexcept {
+    ++counter;
+    return std::malloc(size ? size : 1);
+}
+
+#ifdef __cpp_aligned_new
+void* allocateAligned(const std::size_t size, const std::align_val_t alignment) noexcept {
+    ++counter;
+    const std::size_t align = std::size_t(alignment);
+    #ifdef _MSC_VER
+    return _aligned_malloc(size ? size : 1, align);
+    #else
+    /* aligned_alloc() wants the size to be a multiple of the alignment */
+    return std::aligned_alloc(align, ((size ? size : 1) + align - 1)/align*align);
+    #endif
+}
+
+void freeAligned(void* const memory) noexcept {
+    #ifdef _MSC_VER
+    _aligned_free(memory);
+    #else
+    std::free(memory);
+    #endif
+}
+#endif
+
+}
+
+namespace Magnum { namespace Examples {
+
+std::size_t allocationCount() { return counter; }
+
+}}
+
+void* operator new(const std::size_t size) {
+    if(void* memory = allocate(size)) return memory;
+    throw std::bad_alloc{};
+}
+
+void* operator new[](const std::size_t size) {
+    if(void* memory = allocate(size)) return memory;
+    throw std::bad_alloc{};
+}
+
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+
+#ifdef __cpp_aligned_new
+void* operator new(const std::size_t size, const std::align_val_t alignment) {
+    if(void* memory = allocateAligned(size, alignment)) return memory;
+    throw std::bad_alloc{};
+}
+
+void* operator new[](const std::size_t size, const std::align_val_t alignment) {
+    if(void* memory = allocateAligned(size, alignment)) return memory;
+    throw std::bad_alloc{};
+}
+
+void* operator new(const std::size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](const std::size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(memory); }
+#endif
@@ -0,0 +1,21 @@
+#ifndef Magnum_Examples_Shadows_AllocationCounter_h
+#define Magnum_Examples_Shadows_AllocationCounter_h
+
+#include <cstddef>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Heap allocations made so far, from all threads
+ *
+ * Linking @cpp AllocationCounter.cpp @ce into an executable replaces every
+ * allocating @cpp operator new @ce of it, the array, aligned and
+ * @cpp std::nothrow @ce ones included, with one that counts the call. Only
+ * the benchmark and the tests link it, the example allocates through the
+ * default ones.
+ */
+std::size_t allocationCount();
+
+}}
+
+#endif
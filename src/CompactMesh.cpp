@@ -0,0 +1,159 @@
+#include "CompactMesh.h"
+
+#include <utility>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/ArrayViewStl.h>
+#include <Magnum/Mesh.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Packing.h>
+#include <Magnum/MeshTools/Tipsify.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "ShadowMath.h"
+
+namespace Magnum { namespace Examples {
+
+namespace {
+
+/* Hits don't move a vertex to the front, same as in hardware */
+Float averageCacheMissRatio(const std::vector<UnsignedInt>& indices,
+                            const std::size_t vertexCount) {
+    /* When each vertex entered the cache, zero for never */
+    std::vector<std::size_t> insertedAt(vertexCount, 0);
+    std::size_t time = 0;
+    for(const UnsignedInt index: indices) {
+        if(insertedAt[index] && time - insertedAt[index] < CompactMeshData::CacheSize)
+            continue;
+        insertedAt[index] = ++time;
+    }
+
+    return indices.empty() ? 0.0f : Float(time)/Float(indices.size()/3);
+}
+
+Shaders::Generic3D::Position positionAttribute(const bool half) {
+    return half ?
+        Shaders::Generic3D::Position{ Shaders::Generic3D::Position::DataType::Half } :
+        Shaders::Generic3D::Position{};
+}
+
+/* Signed normalized, the two bits of W stay zero */
+UnsignedInt packNormal(const Vector3& normal) {
+    const Vector3i packed{ Math::round(Math::clamp(normal, -1.0f, 1.0f)*511.0f) };
+    return (UnsignedInt(packed.x()) & 0x3ff) |
+           (UnsignedInt(packed.y()) & 0x3ff) << 10 |
+           (UnsignedInt(packed.z()) & 0x3ff) << 20;
+}
+
+}
+
+Shaders::Generic3D::Position CompactMeshData::positionAttribute() const {
+    return Examples::positionAttribute(isHalf());
+}
+
+CompactMeshData::operator CompactMeshView() const {
+    CompactMeshView view;
+    view.positions = positions;
+    view.halfPositions = halfPositions;
+    view.normals = normals;
+    view.indices = indices;
+    view.shortIndices = shortIndices;
+    view.radius = radius;
+    view.statistics = statistics;
+    return view;
+}
+
+Shaders::Generic3D::Position CompactMeshView::positionAttribute() const {
+    return Examples::positionAttribute(isHalf());
+}
+
+CompactMeshData compactMesh(const Trade::MeshData& meshData, const bool halfPositions) {
+    CORRADE_INTERNAL_ASSERT(meshData.primitive() == MeshPrimitive::Triangles && meshData.isIndexed());
+
+    return compactMesh(meshData.positions3DAsArray(), meshData.normalsAsArray(),
+                       meshData.indicesAsArray(), halfPositions);
+}
+
+CompactMeshData compactMesh(const Containers::ArrayView<const Vector3> positions,
+                            const Containers::ArrayView<const Vector3> normals,
+                            const Containers::ArrayView<const UnsignedInt> indices,
+                            const bool halfPositions) {
+    CORRADE_INTERNAL_ASSERT(normals.size() == positions.size() && indices.size() % 3 == 0);
+    const UnsignedInt vertexCount = UnsignedInt(positions.size());
+
+    CompactMeshData data;
+    CompactMeshStatistics& statistics = data.statistics;
+    data.indices.assign(indices.begin(), indices.end());
+    statistics.indexCount = data.indices.size();
+    statistics.originalDepthVertexSize = statistics.originalVertexSize = 2*sizeof(Vector3);
+    statistics.originalAcmr = averageCacheMissRatio(data.indices, vertexCount);
+
+    MeshTools::tipsify(data.indices, vertexCount, CompactMeshData::CacheSize);
+
+    /* Vertices nothing refers to get dropped on the way */
+    constexpr UnsignedInt Unused = ~UnsignedInt{};
+    std::vector<UnsignedInt> remap(vertexCount, Unused);
+    UnsignedInt usedCount = 0;
+    for(UnsignedInt& index: data.indices) {
+        if(remap[index] == Unused) remap[index] = usedCount++;
+        index = remap[index];
+    }
+    statistics.vertexCount = usedCount;
+    statistics.acmr = averageCacheMissRatio(data.indices, usedCount);
+
+    if(halfPositions) data.halfPositions.resize(usedCount);
+    else data.positions.resize(usedCount);
+    data.normals.resize(usedCount);
+    for(UnsignedInt i = 0; i != vertexCount; ++i) {
+        const UnsignedInt to = remap[i];
+        if(to == Unused) continue;
+
+        if(halfPositions) data.halfPositions[to] = { Vector3us{ Math::packHalf(positions[i]) }, 0 };
+        else data.positions[to] = positions[i];
+        data.normals[to] = packNormal(normals[i]);
+    }
+
+    /* Unreferenced vertices count as well, which keeps it conservative */
+    data.radius = boundingRadius(positions);
+
+    statistics.depthVertexSize = halfPositions ? sizeof(Vector4us) : sizeof(Vector3);
+    statistics.vertexSize = statistics.depthVertexSize + sizeof(UnsignedInt);
+
+    /* Converted here once, so uploading is a plain copy of the stream */
+    if(usedCount <= 65536) {
+        data.shortIndices.assign(data.indices.begin(), data.indices.end());
+        data.indices = {};
+    }
+
+    return data;
+}
+
+GL::Mesh compileCompactMesh(const CompactMeshView& data) {
+    GL::Buffer positions;
+    if(data.isHalf()) positions.setData(data.halfPositions, GL::BufferUsage::StaticDraw);
+    else positions.setData(data.positions, GL::BufferUsage::StaticDraw);
+
+    GL::Buffer normals;
+    normals.setData(data.normals, GL::BufferUsage::StaticDraw);
+
+    GL::Mesh mesh;
+    mesh.setCount(Int(data.indexCount()))
+        .addVertexBuffer(std::move(positions), 0, data.positionAttribute(),
+                         data.positionPadding())
+        .addVertexBuffer(std::move(normals), 0, CompactMeshData::PackedNormal{
+            CompactMeshData::PackedNormal::DataType::Int2101010Rev,
+            CompactMeshData::PackedNormal::DataOption::Normalized });
+
+    GL::Buffer indices;
+    if(data.indexType() == MeshIndexType::UnsignedShort) {
+        indices.setData(data.shortIndices, GL::BufferUsage::StaticDraw);
+    } else {
+        indices.setData(data.indices, GL::BufferUsage::StaticDraw);
+    }
+    mesh.setIndexBuffer(std::move(indices), 0, data.indexType());
+
+    return mesh;
+}
+
+}}
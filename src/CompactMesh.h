@@ -0,0 +1,143 @@
+#ifndef Magnum_Examples_Shadows_CompactMesh_h
+#define Magnum_Examples_Shadows_CompactMesh_h
+
+#include <vector>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Mesh.h>
+#include <Magnum/GL/GL.h>
+#include <Magnum/Math/Vector4.h>
+#include <Magnum/Shaders/Generic.h>
+#include <Magnum/Trade/Trade.h>
+
+namespace Magnum { namespace Examples {
+
+/** @brief What @ref compactMesh() saved on one mesh */
+struct CompactMeshStatistics {
+    std::size_t vertexCount{};
+    std::size_t indexCount{};
+
+    /* Bytes fetched per vertex by the depth and the main pass. The depth
+       pass used to pull in the interleaved normals as well. */
+    std::size_t originalDepthVertexSize{};
+    std::size_t depthVertexSize{};
+    std::size_t originalVertexSize{};
+    std::size_t vertexSize{};
+
+    /* Average post-transform cache misses per triangle, for a FIFO cache
+       of CacheSize vertices. 0.5 is the best a regular grid can do, 3 means
+       no reuse at all. */
+    Float originalAcmr{};
+    Float acmr{};
+
+    std::size_t originalVertexBytes() const { return vertexCount*originalVertexSize; }
+    std::size_t vertexBytes() const { return vertexCount*vertexSize; }
+};
+
+struct CompactMeshView;
+
+/**
+ * @brief Vertex and index data prepared for drawing
+ *
+ * Positions and normals are in separate streams, so the depth pass fetches
+ * only the positions. Normals are packed to signed normalized 10-10-10-2
+ * integers. Either @ref positions or @ref halfPositions is filled, the
+ * latter padded to four components to keep each vertex aligned. Same for
+ * @ref indices and @ref shortIndices, the latter used when the vertex
+ * count allows, so everything is in the type it's uploaded in.
+ */
+struct CompactMeshData {
+    /** @brief Normal attribute reading the packed @ref normals */
+    typedef GL::Attribute<Shaders::Generic3D::Normal::Location, Vector4> PackedNormal;
+
+    enum: UnsignedInt { CacheSize = 32 };
+
+    bool isHalf() const { return !halfPositions.empty(); }
+
+    /** @brief Position attribute matching the stream that's filled */
+    Shaders::Generic3D::Position positionAttribute() const;
+
+    /** @brief Gap after each position in the stream that's filled */
+    std::size_t positionPadding() const { return isHalf() ? 2 : 0; }
+
+    /** @brief Type of the index stream that's filled */
+    MeshIndexType indexType() const {
+        return shortIndices.empty() ? MeshIndexType::UnsignedInt : MeshIndexType::UnsignedShort;
+    }
+
+    std::size_t indexCount() const { return indices.size() + shortIndices.size(); }
+
+    std::vector<Vector3> positions;
+    std::vector<Vector4us> halfPositions;
+    std::vector<UnsignedInt> normals;
+    std::vector<UnsignedInt> indices;
+    std::vector<UnsignedShort> shortIndices;
+
+    /** @brief Radius of a sphere around the origin containing all vertices */
+    Float radius{};
+
+    CompactMeshStatistics statistics;
+
+    /** @brief View on all streams, for uploading */
+    operator CompactMeshView() const;
+};
+
+/**
+ * @brief Preprocessed data that's stored elsewhere
+ *
+ * Either in a @ref CompactMeshData or in a file mapped by a
+ * @ref MeshCache, so the data can be uploaded without copying it first.
+ * Same streams as @ref CompactMeshData.
+ */
+struct CompactMeshView {
+    bool isHalf() const { return !halfPositions.empty(); }
+
+    /** @brief Position attribute matching the stream that's filled */
+    Shaders::Generic3D::Position positionAttribute() const;
+
+    /** @brief Gap after each position in the stream that's filled */
+    std::size_t positionPadding() const { return isHalf() ? 2 : 0; }
+
+    /** @brief Type of the index stream that's filled */
+    MeshIndexType indexType() const {
+        return shortIndices.empty() ? MeshIndexType::UnsignedInt : MeshIndexType::UnsignedShort;
+    }
+
+    std::size_t indexCount() const { return indices.size() + shortIndices.size(); }
+
+    Containers::ArrayView<const Vector3> positions;
+    Containers::ArrayView<const Vector4us> halfPositions;
+    Containers::ArrayView<const UnsignedInt> normals;
+    Containers::ArrayView<const UnsignedInt> indices;
+    Containers::ArrayView<const UnsignedShort> shortIndices;
+    Float radius{};
+    CompactMeshStatistics statistics;
+};
+
+/**
+ * @brief Preprocess a mesh for drawing
+ *
+ * Expects an indexed triangle list with a normal for each position.
+ * Reorders the indices for the post-transform vertex cache, then the
+ * vertices in the order they're first used, so fetching them walks memory
+ * forward. Doesn't touch any GL state, so it can run on any thread.
+ */
+CompactMeshData compactMesh(Containers::ArrayView<const Vector3> positions, Containers::ArrayView<const Vector3> normals, Containers::ArrayView<const UnsignedInt> indices, bool halfPositions = false);
+
+/**
+ * @overload
+ *
+ * Expects an indexed triangle mesh with positions and normals.
+ */
+CompactMeshData compactMesh(const Trade::MeshData& meshData, bool halfPositions = false);
+
+/**
+ * @brief Upload the preprocessed data
+ *
+ * The returned mesh owns its buffers. Every stream is uploaded as it is,
+ * without converting or copying it first.
+ */
+GL::Mesh compileCompactMesh(const CompactMeshView& data);
+
+}}
+
+#endif
@@ -0,0 +1,48 @@
+#include "DrawList.h"
+
+#include <algorithm>
+#include <Corrade/Containers/ArrayViewStl.h>
+#include <Magnum/Math/Constants.h>
+#include <Magnum/SceneGraph/AbstractObject.h>
+#include <Magnum/SceneGraph/Camera.h>
+
+namespace Magnum { namespace Examples {
+
+Matrix4 cameraMatrix(SceneGraph::Camera3D& camera) {
+    return camera.object().absoluteTransformationMatrix().invertedRigid();
+}
+
+void sortFrontToBack(DrawableTransformations& drawables,
+                     const Matrix4& cameraMatrix) {
+    /* The camera looks down -Z, nearer is larger */
+    std::sort(drawables.begin(), drawables.end(),
+        [&cameraMatrix](const DrawableTransformations::value_type& a,
+                        const DrawableTransformations::value_type& b) {
+            return cameraMatrix.transformPoint(a.second.translation()).z() >
+                   cameraMatrix.transformPoint(b.second.translation()).z();
+        });
+}
+
+void DrawList::reset(const Containers::ArrayView<const Model> models) {
+    _models = models.data();
+    _instances.resize(models.size());
+    _nearestDepths.assign(models.size(), Constants::inf());
+    for(std::size_t i = 0; i != models.size(); ++i) {
+        _instances[i].clear();
+        _instances[i].reserve(models[i].objectCount);
+    }
+    _lastModel = nullptr;
+    _size = _modelChanges = 0;
+}
+
+void DrawList::enqueue(RenderQueue& queue,
+                       GL::AbstractShaderProgram& shader,
+                       const Containers::ArrayView<Model> models) const {
+    CORRADE_INTERNAL_ASSERT(models.data() == _models && models.size() == _instances.size());
+    for(std::size_t i = 0; i != models.size(); ++i) {
+        queue.add(shader, models[i], UnsignedInt(i), _instances[i], _nearestDepths[i]);
+    }
+    queue.addUnsortedBindChanges(unsortedBindChanges());
+}
+
+}}
@@ -0,0 +1,104 @@
+#ifndef Magnum_Examples_Shadows_DrawList_h
+#define Magnum_Examples_Shadows_DrawList_h
+
+#include <functional>
+#include <utility>
+#include <vector>
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/SceneGraph/SceneGraph.h>
+
+#include "Model.h"
+#include "RenderQueue.h"
+
+namespace Magnum { namespace Examples {
+
+/** @brief Drawables with their transformation relative to a camera */
+typedef std::vector<std::pair<std::reference_wrapper<SceneGraph::Drawable3D>, Matrix4>> DrawableTransformations;
+
+/**
+ * @brief Camera matrix without cleaning the scene graph
+ *
+ * @ref SceneGraph::AbstractCamera::cameraMatrix() cleans the camera object
+ * first, which collects its dirty parents into a temporary vector. This
+ * inverts the absolute transformation directly instead and expects it to
+ * be rigid.
+ */
+Matrix4 cameraMatrix(SceneGraph::Camera3D& camera);
+
+/**
+ * @brief Sort drawables front to back
+ *
+ * Expects world transformations in @p drawables, compares their origin in
+ * the space of @p cameraMatrix.
+ */
+void sortFrontToBack(DrawableTransformations& drawables, const Matrix4& cameraMatrix);
+
+/**
+ * @brief World transformations of the objects a pass draws, per model
+ *
+ * Built while culling, which may happen on a worker thread, and drawn
+ * later by the thread owning the GL context. Clearing keeps the storage,
+ * and every model's list is reserved for all objects using it, so lists
+ * don't allocate anymore once the scene is complete.
+ */
+class DrawList {
+    public:
+        /** @brief Clear the list and set the models it's built for */
+        void reset(Containers::ArrayView<const Model> models);
+
+        /**
+         * @brief Add an instance of a model
+         *
+         * The model has to be one of those passed to @ref reset(). The
+         * instances are drawn in the order they're added, @p depth is the
+         * distance from the camera, used to sort the models.
+         */
+        void add(const Model& model, const Matrix4& transformation, Float depth) {
+            const std::size_t index = &model - _models;
+            CORRADE_INTERNAL_ASSERT(index < _instances.size());
+            _instances[index].push_back(transformation);
+            _nearestDepths[index] = Math::min(_nearestDepths[index], depth);
+            if(&model != _lastModel) ++_modelChanges;
+            _lastModel = &model;
+            ++_size;
+        }
+
+        /** @brief Instance count over all models */
+        std::size_t size() const { return _size; }
+
+        /**
+         * @brief Binds if the instances were drawn one by one
+         *
+         * The shader once and the mesh whenever it's a different model
+         * than the instance added before. What the pass would bind without
+         * the list and @ref RenderQueue, passed to
+         * @ref RenderQueue::addUnsortedBindChanges() by @ref enqueue().
+         */
+        std::size_t unsortedBindChanges() const {
+            return _size ? _modelChanges + 1 : 0;
+        }
+
+        bool empty() const { return !_size; }
+
+        /**
+         * @brief Queue the instances of each model as one draw
+         *
+         * Expects the same models the list was built for. The list has to
+         * stay unchanged until the queue is submitted.
+         */
+        void enqueue(RenderQueue& queue, GL::AbstractShaderProgram& shader, Containers::ArrayView<Model> models) const;
+
+    private:
+        const Model* _models{};
+        std::vector<std::vector<Matrix4>> _instances;
+        std::vector<Float> _nearestDepths;
+        const Model* _lastModel{};
+        std::size_t _size{}, _modelChanges{};
+};
+
+}}
+
+#endif
@@ -0,0 +1,94 @@
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/OpenGLTester.h>
+#include <Magnum/GL/Renderbuffer.h>
+#include <Magnum/GL/RenderbufferFormat.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/SceneGraph/Object.h>
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+
+#include "AllocationCounter.h"
+#include "ShadowsScene.h"
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Checks that rendering a frame doesn't allocate
+ *
+ * Orbits the camera around the generated scene twice. The first orbit
+ * lets the scratch buffers grow to what every view of the scene needs, no
+ * frame of the second one is then allowed to allocate.
+ */
+struct FrameAllocationTest: GL::OpenGLTester {
+    explicit FrameAllocationTest();
+
+    void steadyState();
+};
+
+namespace {
+
+constexpr struct {
+    const char* name;
+    ShadowMode mode;
+    bool occlusionCulling;
+} SteadyStateData[]{
+    { "hard shadows", ShadowMode::Hard, false },
+    { "variance shadows", ShadowMode::Variance, false },
+    { "occlusion culling", ShadowMode::Hard, true }
+};
+
+constexpr Int OrbitFrames = 32;
+
+}
+
+FrameAllocationTest::FrameAllocationTest() {
+    addInstancedTests({ &FrameAllocationTest::steadyState },
+        Containers::arraySize(SteadyStateData));
+}
+
+void FrameAllocationTest::steadyState() {
+    auto&& data = SteadyStateData[testCaseInstanceId()];
+    setTestCaseDescription(data.name);
+
+    const Vector2i size{ 320, 240 };
+
+    ShadowsScene scene;
+    scene.populate();
+    scene.setViewport(size);
+    scene.setShadowMode(data.mode);
+    CORRADE_VERIFY(scene.setupShadowmaps(4, 512));
+    scene.setOcclusionCullingEnabled(data.occlusionCulling);
+
+    GL::Renderbuffer color, depth;
+    color.setStorage(GL::RenderbufferFormat::RGBA8, size);
+    depth.setStorage(GL::RenderbufferFormat::DepthComponent24, size);
+
+    GL::Framebuffer framebuffer{ { {}, size } };
+    framebuffer
+        .attachRenderbuffer(GL::Framebuffer::ColorAttachment{ 0 }, color)
+        .attachRenderbuffer(GL::Framebuffer::BufferAttachment::Depth, depth);
+    CORRADE_COMPARE(framebuffer.checkStatus(GL::FramebufferTarget::Draw),
+                    GL::Framebuffer::Status::Complete);
+
+    for(Int i = 0; i != 2*OrbitFrames; ++i) {
+        const Rad angle{ Constants::tau() * Float(i % OrbitFrames) / Float(OrbitFrames) };
+        scene.cameraObject().setTransformation(Matrix4::lookAt(
+            { Math::sin(angle) * 30.0f, 6.0f, Math::cos(angle) * 30.0f },
+            { 0.0f, 1.0f, 0.0f }, Vector3::yAxis()));
+
+        const std::size_t allocationsBefore = allocationCount();
+        scene.drawShadows();
+        scene.draw(framebuffer);
+        const std::size_t allocations = allocationCount() - allocationsBefore;
+
+        MAGNUM_VERIFY_NO_GL_ERROR();
+        if(i < OrbitFrames) continue;
+
+        CORRADE_ITERATION(i - OrbitFrames);
+        CORRADE_COMPARE(allocations, 0);
+    }
+}
+
+}}
+
+MAGNUM_GL_TEST_MAIN(Magnum::Examples::FrameAllocationTest)
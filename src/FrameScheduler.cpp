@@ -0,0 +1,68 @@
+#include "FrameScheduler.h"
+
+#include <thread>
+#include <Magnum/Math/Functions.h>
+
+namespace Magnum { namespace Examples {
+
+namespace {
+
+/* Frames drawn after an event. ImGui reacts to a click one frame later and
+   the setting it changed shows up in the shadows only in the frame after
+   that. */
+constexpr UnsignedInt SettleFrames = 3;
+
+/* A stall longer than this, like dragging the window, doesn't try to
+   catch up all at once */
+constexpr Float MaxFrameTime = 0.25f;
+
+}
+
+FrameScheduler::FrameScheduler(const Float timestep): _timestep{timestep} {}
+
+void FrameScheduler::setFrameCap(const Float framesPerSecond) {
+    _minFrameTime = framesPerSecond > 0.0f ?
+        std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<Float>{ 1.0f/framesPerSecond }) :
+        Clock::duration{};
+}
+
+void FrameScheduler::invalidate() {
+    _pendingFrames = SettleFrames;
+}
+
+UnsignedInt FrameScheduler::beginFrame() {
+    Clock::time_point now = Clock::now();
+    if(!_running) {
+        _frameStart = now;
+        _running = true;
+        return 0;
+    }
+
+    if(now - _frameStart < _minFrameTime) {
+        std::this_thread::sleep_until(_frameStart + _minFrameTime);
+        now = Clock::now();
+    }
+
+    _accumulated += Math::min(std::chrono::duration<Float>{ now - _frameStart }.count(),
+                              MaxFrameTime);
+    _frameStart = now;
+
+    UnsignedInt steps = 0;
+    while(_accumulated >= _timestep) {
+        _accumulated -= _timestep;
+        ++steps;
+    }
+    return steps;
+}
+
+bool FrameScheduler::endFrame(const bool animating) {
+    if(_pendingFrames) --_pendingFrames;
+    _running = animating || _pendingFrames;
+
+    /* The idle time isn't going to be simulated, neither is what's left */
+    if(!_running) _accumulated = 0.0f;
+    return _running;
+}
+
+}}
@@ -0,0 +1,84 @@
+#ifndef Magnum_Examples_Shadows_FrameScheduler_h
+#define Magnum_Examples_Shadows_FrameScheduler_h
+
+#include <chrono>
+#include <Magnum/Magnum.h>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Decides when a frame is drawn and how far the simulation advances
+ *
+ * Frames are drawn only when something changed: input or a setting calls
+ * @ref invalidate(), an ongoing animation is reported to @ref endFrame().
+ * When neither happens, the application stops requesting redraws and
+ * waits for events instead, using no CPU or GPU time.
+ *
+ * Movement advances in fixed steps, independently of the frame rate. The
+ * drawn state is interpolated between the last two steps by
+ * @ref interpolation(), which trails the simulation by up to one step
+ * but keeps the motion smooth when frames and steps don't line up.
+ *
+ */
+class FrameScheduler {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        /** @brief Constructor, taking the length of a step in seconds */
+        explicit FrameScheduler(Float timestep = 1.0f/60.0f);
+
+        Float timestep() const { return _timestep; }
+
+        /**
+         * @brief Limit the frame rate
+         *
+         * @ref beginFrame() then sleeps if the previous frame started less
+         * than one frame time ago. Zero disables the limit, which is the
+         * default, leaving it to vsync.
+         */
+        void setFrameCap(Float framesPerSecond);
+
+        /**
+         * @brief Draw the next frames even if nothing animates
+         *
+         * Call on input or when a setting changed. A few frames get drawn
+         * so the UI has time to react to the event as well.
+         */
+        void invalidate();
+
+        /**
+         * @brief Start a frame
+         *
+         * Returns how many steps to advance the simulation by. After an
+         * idle period it's zero, the time spent waiting isn't simulated.
+         */
+        UnsignedInt beginFrame();
+
+        /**
+         * @brief Position between the previous and the last step
+         *
+         * In range @f$ [0, 1) @f$, valid after @ref beginFrame().
+         */
+        Float interpolation() const { return _accumulated/_timestep; }
+
+        /**
+         * @brief End a frame
+         *
+         * Returns whether to draw another one, which is the case if
+         * @p animating is set or the frames requested by
+         * @ref invalidate() aren't all drawn yet.
+         */
+        bool endFrame(bool animating);
+
+    private:
+        Float _timestep;
+        Clock::duration _minFrameTime{};
+        Clock::time_point _frameStart;
+        Float _accumulated{};
+        UnsignedInt _pendingFrames{};
+        bool _running{};
+};
+
+}}
+
+#endif
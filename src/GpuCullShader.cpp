@@ -0,0 +1,56 @@
+#include "GpuCullShader.h"
+
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Math/Vector4.h>
+
+namespace Magnum { namespace Examples {
+
+GpuCullShader::GpuCullShader() {
+    MAGNUM_ASSERT_GL_VERSION_SUPPORTED(GL::Version::GL430);
+
+    const Utility::Resource rs{"shadow-data"};
+
+    GL::Shader comp{ GL::Version::GL430, GL::Shader::Type::Compute };
+
+    comp.addSource(rs.get("GpuCull.comp"));
+
+    CORRADE_INTERNAL_ASSERT_OUTPUT(comp.compile());
+
+    attachShader(comp);
+
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+
+    _planesUniform = uniformLocation("planes");
+    _objectCountUniform = uniformLocation("objectCount");
+    _firstCommandUniform = uniformLocation("firstCommand");
+}
+
+GpuCullShader& GpuCullShader::setFrustum(const Frustum& frustum) {
+    /* The spheres are compared against plane distances, which needs
+       normalized planes. The open near plane stays zero. */
+    Vector4 planes[6];
+    for(std::size_t i = 0; i != 6; ++i) {
+        const Vector4 plane = frustum[i];
+        const Float length = plane.xyz().length();
+        planes[i] = length > 0.0f ? plane/length : Vector4{};
+    }
+
+    setUniform(_planesUniform, Containers::arrayView(planes));
+    return *this;
+}
+
+GpuCullShader& GpuCullShader::setObjectCount(const UnsignedInt count) {
+    setUniform(_objectCountUniform, count);
+    return *this;
+}
+
+GpuCullShader& GpuCullShader::setFirstCommand(const UnsignedInt command) {
+    setUniform(_firstCommandUniform, command);
+    return *this;
+}
+
+}}
@@ -0,0 +1,51 @@
+#ifndef Magnum_Examples_Shadows_GpuCullShader_h
+#define Magnum_Examples_Shadows_GpuCullShader_h
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/Math/Frustum.h>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Compute shader culling bounding spheres against a frustum
+ *
+ * Every object found inside gets its transformation appended to the
+ * instances of its model's indirect draw command. See @ref GpuCulling for
+ * the buffer layouts.
+ */
+class GpuCullShader: public GL::AbstractShaderProgram {
+    public:
+        enum: UnsignedInt {
+            ObjectBufferBinding = 0,
+            CommandBufferBinding = 1,
+            InstanceBufferBinding = 2,
+
+            WorkgroupSize = 64
+        };
+
+        explicit GpuCullShader(NoCreateT): GL::AbstractShaderProgram{NoCreate} {}
+
+        explicit GpuCullShader();
+
+        /**
+         * @brief Set the frustum
+         *
+         * A plane with zero normal, like the open near plane of a shadow
+         * volume, lets everything through.
+         */
+        GpuCullShader& setFrustum(const Frustum& frustum);
+
+        GpuCullShader& setObjectCount(UnsignedInt count);
+
+        /** @brief Set the command of the first model in the culled view */
+        GpuCullShader& setFirstCommand(UnsignedInt command);
+
+    private:
+        Int _planesUniform,
+            _objectCountUniform,
+            _firstCommandUniform;
+};
+
+}}
+
+#endif
@@ -0,0 +1,224 @@
+#include "GpuCulling.h"
+
+#include <Corrade/Containers/ArrayViewStl.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Math/Vector4.h>
+#include <Magnum/Shaders/Generic.h>
+
+#include "SpatialIndex.h"
+
+namespace Magnum { namespace Examples {
+
+bool GpuCulling::isSupported() {
+    return GL::Context::current().isVersionSupported(GL::Version::GL430);
+}
+
+void GpuCulling::addMesh(const CompactMeshView& data) {
+    CORRADE_INTERNAL_ASSERT(_meshes.empty() || data.isHalf() == _merged.isHalf());
+
+    _meshes.push_back({ UnsignedInt(_merged.indices.size()),
+                        UnsignedInt(data.indexCount()),
+                        Int(_merged.normals.size()) });
+
+    _merged.positions.insert(_merged.positions.end(), data.positions.begin(), data.positions.end());
+    _merged.halfPositions.insert(_merged.halfPositions.end(), data.halfPositions.begin(), data.halfPositions.end());
+    _merged.normals.insert(_merged.normals.end(), data.normals.begin(), data.normals.end());
+    /* One index type for all models, and only 32 bits fit all of them */
+    _merged.indices.insert(_merged.indices.end(), data.indices.begin(), data.indices.end());
+    _merged.indices.insert(_merged.indices.end(), data.shortIndices.begin(), data.shortIndices.end());
+
+    _meshesDirty = true;
+    _layoutDirty = true;
+}
+
+UnsignedInt GpuCulling::addSource(const SpatialIndex& index) {
+    _sources.emplace_back();
+    Source& source = _sources.back();
+    source.index = &index;
+    if(isSetup()) source.objectBuffer = GL::Buffer{};
+
+    _layoutDirty = true;
+    return UnsignedInt(_sources.size() - 1);
+}
+
+void GpuCulling::setViews(const Containers::ArrayView<const UnsignedInt> sources) {
+    _viewSources.assign(sources.begin(), sources.end());
+    _layoutDirty = true;
+}
+
+void GpuCulling::setup() {
+    CORRADE_INTERNAL_ASSERT(isSupported());
+
+    _cullShader = GpuCullShader{};
+
+    _positionBuffer = GL::Buffer{};
+    _normalBuffer = GL::Buffer{};
+    _indexBuffer = GL::Buffer{};
+    _instanceBuffer = GL::Buffer{};
+    _commandBuffer = GL::Buffer{};
+    _meshesDirty = true;
+
+    for(Source& source: _sources) {
+        source.objectBuffer = GL::Buffer{};
+        source.needsFullUpdate = true;
+    }
+    _layoutDirty = true;
+}
+
+void GpuCulling::update() {
+    for(Source& source: _sources) {
+        const SpatialIndex& index = *source.index;
+        if(source.objects.size() != index.size()) {
+            source.objects.resize(index.size());
+            source.needsFullUpdate = true;
+            _layoutDirty = true;
+        }
+
+        if(source.needsFullUpdate) {
+            for(std::size_t i = 0; i != index.size(); ++i) {
+                updateObject(source, UnsignedInt(i));
+            }
+            source.objectBuffer.setData(source.objects, GL::BufferUsage::DynamicDraw);
+            source.needsFullUpdate = false;
+            continue;
+        }
+
+        /* The moved entries are sorted, each run of consecutive ones is
+           uploaded with a single call. A rebuilt index moves all of them,
+           which is then one call as well. */
+        const Containers::ArrayView<const UnsignedInt> moved = index.movedEntries();
+        for(std::size_t i = 0; i != moved.size(); ) {
+            const UnsignedInt first = moved[i];
+            UnsignedInt end = first;
+            for(; i != moved.size() && moved[i] == end; ++i, ++end) {
+                updateObject(source, end);
+            }
+            source.objectBuffer.setSubData(first*sizeof(Object),
+                Containers::arrayView(source.objects).slice(first, end));
+        }
+    }
+
+    if(_meshesDirty) uploadMeshes();
+    if(_layoutDirty) layoutCommands();
+
+    /* Resets the instance counts the previous frame accumulated */
+    _commandBuffer.setData(_commands, GL::BufferUsage::DynamicDraw);
+}
+
+/* Everything again, meshes get added only while a scene is loading */
+void GpuCulling::uploadMeshes() {
+    if(_merged.isHalf()) _positionBuffer.setData(_merged.halfPositions, GL::BufferUsage::StaticDraw);
+    else _positionBuffer.setData(_merged.positions, GL::BufferUsage::StaticDraw);
+    _normalBuffer.setData(_merged.normals, GL::BufferUsage::StaticDraw);
+    _indexBuffer.setData(_merged.indices, GL::BufferUsage::StaticDraw);
+
+    /* The position format is known only after the first mesh. The
+       instance attribute is offset by the base instance of each command,
+       so every model finds its own instances. */
+    _mesh = GL::Mesh{};
+    _mesh.addVertexBuffer(_positionBuffer, 0, _merged.positionAttribute(),
+                          _merged.positionPadding())
+         .addVertexBuffer(_normalBuffer, 0, CompactMeshData::PackedNormal{
+             CompactMeshData::PackedNormal::DataType::Int2101010Rev,
+             CompactMeshData::PackedNormal::DataOption::Normalized })
+         .setIndexBuffer(_indexBuffer, 0, MeshIndexType::UnsignedInt)
+         .addVertexBufferInstanced(_instanceBuffer, 1, 0,
+                                   Shaders::Generic3D::TransformationMatrix{});
+
+    _meshesDirty = false;
+}
+
+void GpuCulling::updateObject(Source& source, const UnsignedInt i) {
+    const SpatialIndex& index = *source.index;
+    Object& object = source.objects[i];
+    object.transformation = index.transformation(i);
+    object.sphere = index.boundingSphere(i);
+    object.model = index.modelId(i);
+    CORRADE_INTERNAL_ASSERT(object.model < _meshes.size());
+}
+
+void GpuCulling::invalidate() {
+    for(Source& source: _sources) source.needsFullUpdate = true;
+}
+
+/* Each view gets one command per model, with room for all objects of
+   that model in the culled source */
+void GpuCulling::layoutCommands() {
+    for(Source& source: _sources) {
+        source.modelCounts.assign(_meshes.size(), 0);
+        for(const Object& object: source.objects) {
+            ++source.modelCounts[object.model];
+        }
+    }
+
+    _commands.clear();
+    UnsignedInt baseInstance = 0;
+    for(const UnsignedInt view: _viewSources) {
+        const Source& source = _sources[view];
+        for(std::size_t i = 0; i != _meshes.size(); ++i) {
+            _commands.push_back({ _meshes[i].indexCount, 0,
+                                  _meshes[i].firstIndex,
+                                  _meshes[i].baseVertex,
+                                  baseInstance });
+            baseInstance += source.modelCounts[i];
+        }
+    }
+
+    _instanceBuffer.setData({ nullptr, baseInstance*sizeof(Matrix4) },
+                            GL::BufferUsage::DynamicCopy);
+    _layoutDirty = false;
+}
+
+void GpuCulling::cull(const UnsignedInt view, const Frustum& frustum) {
+    Source& source = _sources[_viewSources[view]];
+    if(source.objects.empty()) return;
+
+    source.objectBuffer.bind(GL::Buffer::Target::ShaderStorage,
+                             GpuCullShader::ObjectBufferBinding);
+    _commandBuffer.bind(GL::Buffer::Target::ShaderStorage,
+                        GpuCullShader::CommandBufferBinding);
+    _instanceBuffer.bind(GL::Buffer::Target::ShaderStorage,
+                         GpuCullShader::InstanceBufferBinding);
+
+    const UnsignedInt objectCount = UnsignedInt(source.objects.size());
+    _cullShader.setFrustum(frustum)
+               .setObjectCount(objectCount)
+               .setFirstCommand(UnsignedInt(view*_meshes.size()))
+               .dispatchCompute({ (objectCount + GpuCullShader::WorkgroupSize - 1)/GpuCullShader::WorkgroupSize, 1, 1 });
+}
+
+void GpuCulling::finishCulling() {
+    GL::Renderer::setMemoryBarrier(GL::Renderer::MemoryBarrier::Command |
+                                   GL::Renderer::MemoryBarrier::VertexAttributeArray);
+}
+
+void GpuCulling::draw(const UnsignedInt view,
+                      GL::AbstractShaderProgram& shader,
+                      DrawStatistics& statistics) {
+    /* There's no indirect drawing in Magnum yet, so this is raw GL. Its
+       state tracker has to be told, otherwise it'd assume the bindings
+       it made last are still there. */
+    GL::Context::current().resetState(GL::Context::State::EnterExternal);
+
+    glUseProgram(shader.id());
+    glBindVertexArray(_mesh.id());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer.id());
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(view*_meshes.size()*sizeof(DrawCommand)),
+        GLsizei(_meshes.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+
+    GL::Context::current().resetState(GL::Context::State::ExitExternal);
+
+    ++statistics.drawCalls;
+
+    /* One shader and one mesh, however many models there are */
+    statistics.bindChanges += 2;
+    statistics.unsortedBindChanges += 2;
+}
+
+}}
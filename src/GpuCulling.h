@@ -0,0 +1,173 @@
+#ifndef Magnum_Examples_Shadows_GpuCulling_h
+#define Magnum_Examples_Shadows_GpuCulling_h
+
+#include <vector>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include "CompactMesh.h"
+#include "GpuCullShader.h"
+#include "Model.h"
+
+namespace Magnum { namespace Examples {
+
+class SpatialIndex;
+
+/**
+ * @brief Frustum culling and draw submission done entirely on the GPU
+ *
+ * All models are merged into a single mesh and the objects of each
+ * @ref SpatialIndex mirrored in a shader storage buffer. For every view,
+ * a compute shader culls the objects of one index against the view
+ * frustum and writes one indirect draw command per model, which is then
+ * submitted with a single @cpp glMultiDrawElementsIndirect() @ce. The CPU
+ * only uploads objects that moved and a small, fixed amount of commands,
+ * no matter how many objects there are.
+ *
+ * Needs compute shaders, shader storage buffers and multi-draw-indirect,
+ * which is OpenGL 4.3, see @ref isSupported().
+ *
+ */
+class GpuCulling {
+    public:
+        /** @brief Whether the context can do GPU culling */
+        static bool isSupported();
+
+        /**
+         * @brief Add a model mesh
+         *
+         * Keeps a copy of the vertex streams and indices, the merged mesh
+         * is uploaded again on the next @ref update() if it's added after
+         * @ref setup(). Models have to be added in the same order as the
+         * model IDs given to @ref SpatialIndex::add() and all either with
+         * or without half-float positions.
+         */
+        void addMesh(const CompactMeshView& data);
+
+        /**
+         * @brief Add a spatial index as an object source
+         *
+         * Returns its ID for @ref setViews(). The index has to stay alive
+         * for the lifetime of this instance.
+         */
+        UnsignedInt addSource(const SpatialIndex& index);
+
+        /**
+         * @brief Set the source each view culls
+         *
+         * View @cpp i @ce culls the source at @cpp sources[i] @ce.
+         */
+        void setViews(Containers::ArrayView<const UnsignedInt> sources);
+
+        std::size_t viewCount() const { return _viewSources.size(); }
+
+        /**
+         * @brief Create the GPU resources
+         *
+         * Compiles the shader and creates the buffers, the meshes are
+         * uploaded by the next @ref update(). Has to be called with a
+         * current GL context.
+         */
+        void setup();
+
+        bool isSetup() const { return _cullShader.id(); }
+
+        /**
+         * @brief Prepare a new frame
+         *
+         * Uploads meshes added since the last frame and objects moved
+         * since then, which expects the indices to be refitted already,
+         * and resets the draw commands.
+         */
+        void update();
+
+        /**
+         * @brief Upload all objects on the next @ref update()
+         *
+         * Only the objects moved since the last refit are uploaded
+         * otherwise, so this is needed when frames were rendered without
+         * calling @ref update().
+         */
+        void invalidate();
+
+        /** @brief Cull a view against a world-space frustum */
+        void cull(UnsignedInt view, const Frustum& frustum);
+
+        /** @brief Make the results of all culled views visible to the draws */
+        void finishCulling();
+
+        /**
+         * @brief Draw everything a view found with one call
+         *
+         * The shader is expected to take positions, normals and the
+         * instance transformation through the generic attributes. Adds the
+         * draw call to @p statistics, the triangle count isn't known on the
+         * CPU.
+         */
+        void draw(UnsignedInt view, GL::AbstractShaderProgram& shader, DrawStatistics& statistics);
+
+    private:
+        /* Same layouts as in GpuCull.comp */
+        struct Object {
+            Matrix4 transformation;
+            Vector4 sphere;
+            UnsignedInt model;
+            UnsignedInt padding[3];
+        };
+
+        struct DrawCommand {
+            UnsignedInt count;
+            UnsignedInt instanceCount;
+            UnsignedInt firstIndex;
+            Int baseVertex;
+            UnsignedInt baseInstance;
+        };
+
+        struct MeshRange {
+            UnsignedInt firstIndex;
+            UnsignedInt indexCount;
+            Int baseVertex;
+        };
+
+        struct Source {
+            const SpatialIndex* index;
+            GL::Buffer objectBuffer{NoCreate};
+            std::vector<Object> objects;
+
+            /* Objects of each model, the space its instances need */
+            std::vector<UnsignedInt> modelCounts;
+            bool needsFullUpdate{ true };
+        };
+
+        void uploadMeshes();
+        void updateObject(Source& source, UnsignedInt object);
+        void layoutCommands();
+
+        /* Streams of all models one after another, in the same format */
+        CompactMeshData _merged;
+        bool _meshesDirty{};
+        std::vector<MeshRange> _meshes;
+
+        std::vector<Source> _sources;
+        std::vector<UnsignedInt> _viewSources;
+
+        /* Initial commands for all views, uploaded every frame to reset the
+           instance counts */
+        std::vector<DrawCommand> _commands;
+        bool _layoutDirty{};
+
+        GpuCullShader _cullShader{NoCreate};
+        GL::Buffer _positionBuffer{NoCreate};
+        GL::Buffer _normalBuffer{NoCreate};
+        GL::Buffer _indexBuffer{NoCreate};
+        GL::Buffer _instanceBuffer{NoCreate};
+        GL::Buffer _commandBuffer{NoCreate};
+        GL::Mesh _mesh{NoCreate};
+};
+
+}}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef Magnum_Examples_Shadows_Hash_h
+#define Magnum_Examples_Shadows_Hash_h
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Magnum.h>
+
+namespace Magnum { namespace Examples {
+
+/** @brief Start value for @ref hashBytes() */
+constexpr const UnsignedLong HashSeed = 0xcbf29ce484222325ull;
+
+/**
+ * @brief Continue a 64-bit FNV-1a hash
+ *
+ * Not cryptographic, but enough to tell cached data apart. Pass
+ * @ref HashSeed as @p value for the first chunk and the result of the
+ * previous call for the next ones.
+ */
+inline UnsignedLong hashBytes(UnsignedLong value, const Containers::ArrayView<const void> data) {
+    const auto* bytes = static_cast<const unsigned char*>(data.data());
+    for(std::size_t i = 0; i != data.size(); ++i) {
+        value ^= bytes[i];
+        value *= 0x100000001b3ull;
+    }
+    return value;
+}
+
+}}
+
+#endif
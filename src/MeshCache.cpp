@@ -0,0 +1,252 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <unordered_set>
+#include <Corrade/Utility/Assert.h>
+#include <Corrade/Utility/Debug.h>
+#include <Magnum/Mesh.h>
+#include <Magnum/Math/Vector4.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "Hash.h"
+
+namespace Magnum { namespace Examples {
+
+namespace {
+
+constexpr const char Magic[8]{ 'S', 'H', 'M', 'C', 'A', 'C', 'H', 'E' };
+
+/* Bump on any change to the file layout or to what compactMesh() outputs */
+constexpr UnsignedInt Version = 2;
+
+constexpr std::size_t StreamAlignment = 16;
+
+std::size_t aligned(const std::size_t size) {
+    return (size + StreamAlignment - 1)/StreamAlignment*StreamAlignment;
+}
+
+}
+
+MeshCache::MeshCache(const std::string& filename): _filename{filename} {
+    if(_filename.empty() || !Utility::Directory::exists(_filename)) return;
+
+    #if defined(CORRADE_TARGET_UNIX) || (defined(CORRADE_TARGET_WINDOWS) && !defined(CORRADE_TARGET_WINDOWS_RT))
+    _file = Utility::Directory::mapRead(_filename);
+    #else
+    _file = Utility::Directory::read(_filename);
+    #endif
+
+    const Header* header = reinterpret_cast<const Header*>(_file.data());
+    if(_file.size() < sizeof(Header) ||
+       std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 ||
+       header->version != Version ||
+       _file.size() < sizeof(Header) + header->entryCount*sizeof(Entry)) {
+        Warning() << "Ignoring an outdated mesh cache" << _filename;
+        _file = nullptr;
+        return;
+    }
+
+    const auto* entries = reinterpret_cast<const Entry*>(_file.data() + sizeof(Header));
+    for(std::size_t i = 0; i != header->entryCount; ++i) {
+        const Entry& entry = entries[i];
+        const std::size_t size =
+            aligned(entry.vertexCount*(entry.halfPositions ? sizeof(Vector4us) : sizeof(Vector3))) +
+            aligned(entry.vertexCount*sizeof(UnsignedInt)) +
+            entry.indexCount*(entry.shortIndices ? sizeof(UnsignedShort) : sizeof(UnsignedInt));
+        if(entry.offset % StreamAlignment || entry.offset + size > _file.size()) {
+            Warning() << "Ignoring a truncated mesh cache" << _filename;
+            _entries.clear();
+            _file = nullptr;
+            return;
+        }
+
+        _entries.emplace(entry.hash, entry);
+    }
+}
+
+CompactMeshView MeshCache::view(const Entry& entry) const {
+    const char* data = _file.data() + entry.offset;
+
+    CompactMeshView view;
+    if(entry.halfPositions) {
+        view.halfPositions = { reinterpret_cast<const Vector4us*>(data), entry.vertexCount };
+        data += aligned(view.halfPositions.size()*sizeof(Vector4us));
+    } else {
+        view.positions = { reinterpret_cast<const Vector3*>(data), entry.vertexCount };
+        data += aligned(view.positions.size()*sizeof(Vector3));
+    }
+    view.normals = { reinterpret_cast<const UnsignedInt*>(data), entry.vertexCount };
+    data += aligned(view.normals.size()*sizeof(UnsignedInt));
+    if(entry.shortIndices) {
+        view.shortIndices = { reinterpret_cast<const UnsignedShort*>(data), entry.indexCount };
+    } else {
+        view.indices = { reinterpret_cast<const UnsignedInt*>(data), entry.indexCount };
+    }
+    view.radius = entry.radius;
+
+    /* What compactMesh() fills in besides the two ratios */
+    CompactMeshStatistics& statistics = view.statistics;
+    statistics.vertexCount = entry.vertexCount;
+    statistics.indexCount = entry.indexCount;
+    statistics.originalDepthVertexSize = statistics.originalVertexSize = 2*sizeof(Vector3);
+    statistics.depthVertexSize = entry.halfPositions ? sizeof(Vector4us) : sizeof(Vector3);
+    statistics.vertexSize = statistics.depthVertexSize + sizeof(UnsignedInt);
+    statistics.originalAcmr = entry.originalAcmr;
+    statistics.acmr = entry.acmr;
+    return view;
+}
+
+CompactMeshView MeshCache::get(const Trade::MeshData& meshData, const bool halfPositions) {
+    CORRADE_INTERNAL_ASSERT(meshData.primitive() == MeshPrimitive::Triangles && meshData.isIndexed());
+
+    return get(meshData.positions3DAsArray(), meshData.normalsAsArray(),
+               meshData.indicesAsArray(), halfPositions);
+}
+
+CompactMeshView MeshCache::get(const Containers::ArrayView<const Vector3> positions,
+                               const Containers::ArrayView<const Vector3> normals,
+                               const Containers::ArrayView<const UnsignedInt> indices,
+                               const bool halfPositions) {
+    /* The sizes keep the streams from running into each other. With 64
+       bits, an accidental collision between a few thousand meshes isn't
+       going to happen. */
+    const UnsignedLong sizes[]{ positions.size(), indices.size(), halfPositions };
+    UnsignedLong key = hashBytes(HashSeed, Containers::arrayView(sizes));
+    key = hashBytes(key, positions);
+    key = hashBytes(key, normals);
+    key = hashBytes(key, indices);
+
+    CompactMeshView out;
+    if(find(key, out)) return out;
+    return add(key, positions, normals, indices, halfPositions);
+}
+
+UnsignedLong MeshCache::fileMeshKey(const UnsignedLong fileHash,
+                                    const UnsignedInt mesh,
+                                    const bool halfPositions) {
+    const UnsignedLong values[]{ fileHash, Version, mesh, halfPositions };
+    return hashBytes(HashSeed, Containers::arrayView(values));
+}
+
+bool MeshCache::find(const UnsignedLong key, CompactMeshView& out) {
+    std::lock_guard<std::mutex> lock{ _mutex };
+
+    const auto found = _entries.find(key);
+    if(found != _entries.end()) {
+        _used.push_back(key);
+        ++_hitCount;
+        out = view(found->second);
+        return true;
+    }
+
+    /* Added by another thread this run, which add() counted already */
+    const auto added = _addedByHash.find(key);
+    if(added != _addedByHash.end()) {
+        _used.push_back(key);
+        out = *added->second;
+        return true;
+    }
+
+    return false;
+}
+
+CompactMeshView MeshCache::add(const UnsignedLong key,
+                               const Containers::ArrayView<const Vector3> positions,
+                               const Containers::ArrayView<const Vector3> normals,
+                               const Containers::ArrayView<const UnsignedInt> indices,
+                               const bool halfPositions) {
+    /* Outside of the lock, this is the slow part */
+    CompactMeshData data = compactMesh(positions, normals, indices, halfPositions);
+
+    std::lock_guard<std::mutex> lock{ _mutex };
+    _used.push_back(key);
+    ++_missCount;
+
+    /* Another thread might have done the same mesh in the meantime */
+    const auto added = _addedByHash.find(key);
+    if(added != _addedByHash.end()) return *added->second;
+
+    _added.push_back(std::move(data));
+    _addedByHash.emplace(key, &_added.back());
+    return _added.back();
+}
+
+bool MeshCache::save() {
+    if(_filename.empty() || !_missCount) return true;
+
+    std::vector<Entry> entries;
+    std::vector<CompactMeshView> views;
+    std::unordered_set<UnsignedLong> written;
+    for(const UnsignedLong key: _used) {
+        if(!written.insert(key).second) continue;
+
+        const auto found = _entries.find(key);
+        views.push_back(found != _entries.end() ?
+            view(found->second) : CompactMeshView(*_addedByHash.at(key)));
+        const CompactMeshView& mesh = views.back();
+
+        Entry entry{};
+        entry.hash = key;
+        entry.vertexCount = UnsignedInt(mesh.normals.size());
+        entry.indexCount = UnsignedInt(mesh.indexCount());
+        entry.halfPositions = mesh.isHalf();
+        entry.shortIndices = mesh.indexType() == MeshIndexType::UnsignedShort;
+        entry.radius = mesh.radius;
+        entry.originalAcmr = mesh.statistics.originalAcmr;
+        entry.acmr = mesh.statistics.acmr;
+        entries.push_back(entry);
+    }
+
+    std::size_t size = aligned(sizeof(Header) + entries.size()*sizeof(Entry));
+    for(std::size_t i = 0; i != entries.size(); ++i) {
+        entries[i].offset = size;
+        const CompactMeshView& mesh = views[i];
+        size += aligned(mesh.isHalf() ? mesh.halfPositions.size()*sizeof(Vector4us) :
+                                        mesh.positions.size()*sizeof(Vector3)) +
+                aligned(mesh.normals.size()*sizeof(UnsignedInt)) +
+                aligned(mesh.indices.size()*sizeof(UnsignedInt)) +
+                aligned(mesh.shortIndices.size()*sizeof(UnsignedShort));
+    }
+
+    Containers::Array<char> out{ Containers::ValueInit, size };
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.entryCount = UnsignedInt(entries.size());
+    std::memcpy(out.data(), &header, sizeof(Header));
+    std::memcpy(out.data() + sizeof(Header), entries.data(), entries.size()*sizeof(Entry));
+
+    for(std::size_t i = 0; i != entries.size(); ++i) {
+        const CompactMeshView& mesh = views[i];
+        char* data = out.data() + entries[i].offset;
+        const auto copy = [&data](const Containers::ArrayView<const void> stream) {
+            std::memcpy(data, stream.data(), stream.size());
+            data += aligned(stream.size());
+        };
+        if(mesh.isHalf()) copy(mesh.halfPositions);
+        else copy(mesh.positions);
+        copy(mesh.normals);
+        /* Only one of them is filled */
+        copy(mesh.indices);
+        copy(mesh.shortIndices);
+    }
+
+    /* Everything's copied out, so the file can be replaced */
+    views.clear();
+    _file = nullptr;
+    _entries.clear();
+    _added.clear();
+    _addedByHash.clear();
+    _used.clear();
+
+    const std::string temporary = _filename + ".tmp";
+    if(!Utility::Directory::write(temporary, out) ||
+       !Utility::Directory::move(temporary, _filename)) {
+        Warning() << "Can't write the mesh cache to" << _filename;
+        return false;
+    }
+
+    return true;
+}
+
+}}
@@ -0,0 +1,148 @@
+#ifndef Magnum_Examples_Shadows_MeshCache_h
+#define Magnum_Examples_Shadows_MeshCache_h
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Utility/Directory.h>
+
+#include "CompactMesh.h"
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief File of already preprocessed meshes
+ *
+ * Keeps what @ref compactMesh() produced, together with the bounds, in a
+ * file that's memory-mapped on the next run. Each mesh is stored under a
+ * key, so a mesh that changed is preprocessed again and one that's
+ * unchanged comes straight from the mapping, ready for
+ * @ref compileCompactMesh(). @ref get() keys meshes by a hash of their
+ * positions, normals and indices. Meshes imported from a file can be
+ * keyed by @ref fileMeshKey() instead, which is known before the import,
+ * so a hit skips importing the mesh as well. Streams start at 16-byte
+ * boundaries and are in the type uploaded to the GPU, indices included.
+ * The file is written for the machine that wrote it, with no byte order
+ * conversion.
+ *
+ * A coarser LOD is a mesh of its own and gets an entry of its own.
+ *
+ */
+class MeshCache {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * Maps @p filename if it exists and was written by the same
+         * version of the format. With an empty filename, every mesh is
+         * preprocessed and nothing is saved.
+         */
+        explicit MeshCache(const std::string& filename = {});
+
+        MeshCache(const MeshCache&) = delete;
+        MeshCache& operator=(const MeshCache&) = delete;
+
+        /** @brief Whether meshes are looked up and saved at all */
+        bool isEnabled() const { return !_filename.empty(); }
+
+        /**
+         * @brief Preprocessed mesh, from the file if it's there
+         *
+         * Arguments are the same as for @ref compactMesh(). The returned
+         * view stays valid until @ref save() or destruction. Can be
+         * called from multiple threads at once.
+         */
+        CompactMeshView get(Containers::ArrayView<const Vector3> positions, Containers::ArrayView<const Vector3> normals, Containers::ArrayView<const UnsignedInt> indices, bool halfPositions = false);
+
+        /** @overload */
+        CompactMeshView get(const Trade::MeshData& meshData, bool halfPositions = false);
+
+        /**
+         * @brief Key of a mesh imported from a file
+         * @param fileHash      @ref hashBytes() of the whole source file
+         * @param mesh          ID of the mesh in the file
+         * @param halfPositions Same as for @ref compactMesh()
+         *
+         * Includes the version of the cache format, so a change in the
+         * preprocessing gives every mesh a new key.
+         */
+        static UnsignedLong fileMeshKey(UnsignedLong fileHash, UnsignedInt mesh, bool halfPositions = false);
+
+        /**
+         * @brief Mesh stored under a key
+         *
+         * If it's there, fills @p out and counts as a hit. Can be called
+         * from multiple threads at once, same as the rest.
+         */
+        bool find(UnsignedLong key, CompactMeshView& out);
+
+        /**
+         * @brief Preprocess a mesh and store it under a key
+         *
+         * Arguments are the same as for @ref compactMesh(). The returned
+         * view stays valid until @ref save() or destruction.
+         */
+        CompactMeshView add(UnsignedLong key, Containers::ArrayView<const Vector3> positions, Containers::ArrayView<const Vector3> normals, Containers::ArrayView<const UnsignedInt> indices, bool halfPositions = false);
+
+        /** @brief Meshes found in the file and preprocessed so far */
+        std::size_t hitCount() const { return _hitCount; }
+        std::size_t missCount() const { return _missCount; }
+
+        /**
+         * @brief Write the meshes requested so far
+         *
+         * Entries that weren't requested, like earlier versions of a mesh
+         * that changed, are dropped. Does nothing if everything came from
+         * the file. Unmaps the file, so views returned before can't be
+         * used anymore.
+         */
+        bool save();
+
+    private:
+        /* Same layout in the file */
+        struct Header {
+            char magic[8];
+            UnsignedInt version;
+            UnsignedInt entryCount;
+        };
+
+        struct Entry {
+            UnsignedLong hash;
+            UnsignedLong offset;
+            UnsignedInt vertexCount;
+            UnsignedInt indexCount;
+            UnsignedShort halfPositions;
+            UnsignedShort shortIndices;
+            Float radius;
+            Float originalAcmr;
+            Float acmr;
+        };
+
+        CompactMeshView view(const Entry& entry) const;
+
+        std::string _filename;
+
+        #if defined(CORRADE_TARGET_UNIX) || (defined(CORRADE_TARGET_WINDOWS) && !defined(CORRADE_TARGET_WINDOWS_RT))
+        Containers::Array<const char, Utility::Directory::MapDeleter> _file;
+        #else
+        Containers::Array<char> _file;
+        #endif
+        std::unordered_map<UnsignedLong, Entry> _entries;
+
+        std::mutex _mutex;
+
+        /* Deque so adding doesn't move the data of views given out */
+        std::deque<CompactMeshData> _added;
+        std::unordered_map<UnsignedLong, const CompactMeshData*> _addedByHash;
+
+        /* Requested this run, in order, which is what gets saved */
+        std::vector<UnsignedLong> _used;
+        std::size_t _hitCount{}, _missCount{};
+};
+
+}}
+
+#endif
@@ -0,0 +1,41 @@
+#include "Model.h"
+
+#include <utility>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Shaders/Generic.h>
+
+namespace Magnum { namespace Examples {
+
+void Model::setMesh(GL::Mesh&& compiledMesh) {
+    mesh = std::move(compiledMesh);
+    instanceBuffer = GL::Buffer{};
+    mesh.addVertexBufferInstanced(instanceBuffer, 1, 0,
+                                  Shaders::Generic3D::TransformationMatrix{});
+}
+
+void Model::drawInstances(GL::AbstractShaderProgram& shader,
+                          const Containers::ArrayView<const Matrix4> transformations,
+                          DrawStatistics& statistics) {
+    if(transformations.empty()) return;
+
+    instanceBuffer.setData(transformations, GL::BufferUsage::StreamDraw);
+    mesh.setInstanceCount(Int(transformations.size()));
+    shader.draw(mesh);
+
+    ++statistics.drawCalls;
+    statistics.triangles += transformations.size() * (mesh.count() / 3);
+}
+
+UnsignedInt Model::selectLod(const UnsignedInt current,
+                             const Float screenSize,
+                             const Float hysteresis) const {
+    UnsignedInt level = Math::min(current, UnsignedInt(lods.size()));
+    while(level != lods.size() && screenSize < lods[level].maxScreenSize)
+        ++level;
+    while(level && screenSize > lods[level - 1].maxScreenSize*(1.0f + hysteresis))
+        --level;
+    return level;
+}
+
+}}
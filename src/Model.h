@@ -0,0 +1,102 @@
+#ifndef Magnum_Examples_Shadows_Model_h
+#define Magnum_Examples_Shadows_Model_h
+
+#include <vector>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include "CompactMesh.h"
+
+namespace Magnum { namespace Examples {
+
+/** @brief Draw call and triangle counts of a render pass */
+struct DrawStatistics {
+    std::size_t drawCalls{};
+    std::size_t triangles{};
+
+    /* Shader plus mesh binds, as submitted and as they'd be drawing the
+       objects one by one in the order culling found them, see
+       RenderQueue::submit() */
+    std::size_t bindChanges{};
+    std::size_t unsortedBindChanges{};
+};
+
+/**
+ * @brief A mesh shared by many scene objects
+ *
+ * Drawables don't draw the mesh themselves, culling collects their
+ * transformations into a @ref DrawList and all instances are then drawn
+ * with a single instanced draw call in @ref drawInstances().
+ *
+ * Coarser variants of the mesh are models of their own, living in the same
+ * array and listed in @ref lods. Each instance picks one of them, see
+ * @ref lod().
+ *
+ */
+struct Model {
+    /** @brief A coarser variant */
+    struct Lod {
+        /* Index in the model array */
+        std::size_t model;
+
+        /* Used below this projected size, the bounding sphere diameter as a
+           fraction of the viewport height */
+        Float maxScreenSize;
+    };
+
+    /**
+     * @brief Set the mesh
+     *
+     * Attaches the per-instance transformation buffer to it as the
+     * @ref Shaders::Generic3D::TransformationMatrix attribute.
+     */
+    void setMesh(GL::Mesh&& compiledMesh);
+
+    /**
+     * @brief Draw instances with given world transformations
+     *
+     * Does nothing if @p transformations is empty. Adds the draw call and
+     * triangles to @p statistics, expecting the mesh to be an indexed
+     * triangle list.
+     */
+    void drawInstances(GL::AbstractShaderProgram& shader, Containers::ArrayView<const Matrix4> transformations, DrawStatistics& statistics);
+
+    /**
+     * @brief Model drawn at given LOD level
+     *
+     * Level zero is this model, level @cpp i @ce the model of
+     * @cpp lods[i - 1] @ce in @p models.
+     */
+    const Model& lod(Containers::ArrayView<const Model> models, UnsignedInt level) const {
+        return level ? models[lods[level - 1].model] : *this;
+    }
+
+    /**
+     * @brief Pick a LOD level for a projected size
+     *
+     * Goes coarser as soon as @p screenSize drops below a threshold, but
+     * back finer only once it's above it by @p hysteresis, relative, so
+     * objects right at the threshold don't switch every frame.
+     */
+    UnsignedInt selectLod(UnsignedInt current, Float screenSize, Float hysteresis) const;
+
+    GL::Mesh mesh{ NoCreate };
+    GL::Buffer instanceBuffer{ NoCreate };
+    Float radius{};
+
+    /* Vertex format and index order savings, see compactMesh() */
+    CompactMeshStatistics meshStatistics;
+
+    /* Coarser variants, in increasing distance */
+    std::vector<Lod> lods;
+
+    /* Scene objects using the mesh or, for LODs, the model they belong to.
+       The most instances a pass can draw. */
+    std::size_t objectCount{};
+};
+
+}}
+
+#endif
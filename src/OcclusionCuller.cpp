@@ -0,0 +1,211 @@
+#include "OcclusionCuller.h"
+
+#include <utility>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/AbstractFramebuffer.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/PixelFormat.h>
+#include <Magnum/Math/Constants.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Vector4.h>
+
+#include "ThreadPool.h"
+
+namespace Magnum { namespace Examples {
+
+namespace {
+
+/* Past this, the grown spheres cover most of the screen anyway */
+constexpr Float MaxCameraDistance = 2.0f;
+
+/* Rows of a level one pool iteration reduces */
+constexpr Int RowBatchSize = 16;
+
+}
+
+OcclusionCuller::OcclusionCuller() {
+    for(Capture& capture: _captures) {
+        capture.image = GL::BufferImage2D{ GL::PixelFormat::DepthComponent, GL::PixelType::Float };
+    }
+}
+
+OcclusionCuller::~OcclusionCuller() {
+    for(Capture& capture: _captures) if(capture.fence) glDeleteSync(capture.fence);
+}
+
+OcclusionCuller::OcclusionCuller(OcclusionCuller&& other) noexcept {
+    *this = std::move(other);
+}
+
+OcclusionCuller& OcclusionCuller::operator=(OcclusionCuller&& other) noexcept {
+    using std::swap;
+    swap(_captures, other._captures);
+    swap(_nextCapture, other._nextCapture);
+    swap(_depths, other._depths);
+    swap(_levels, other._levels);
+    swap(_size, other._size);
+    swap(_viewProjection, other._viewProjection);
+    swap(_eye, other._eye);
+    swap(_margin, other._margin);
+    swap(_active, other._active);
+    return *this;
+}
+
+void OcclusionCuller::capture(GL::AbstractFramebuffer& framebuffer,
+                              const Matrix4& projection,
+                              const Matrix4& cameraMatrix) {
+    Capture& capture = _captures[_nextCapture];
+    _nextCapture = (_nextCapture + 1) % CaptureCount;
+
+    /* Never picked up, the GPU is further behind than usual */
+    if(capture.fence) glDeleteSync(capture.fence);
+
+    /* Goes into the pack buffer, the call returns right away */
+    framebuffer.read(framebuffer.viewport(), capture.image, GL::BufferUsage::StreamRead);
+    capture.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    capture.viewProjection = projection*cameraMatrix;
+    capture.eye = cameraMatrix.invertedRigid().translation();
+}
+
+bool OcclusionCuller::update(const Matrix4& cameraMatrix, ThreadPool& pool) {
+    /* Newest first. Once one is built, the older ones are of no use. */
+    bool built = false;
+    for(std::size_t i = 1; i <= CaptureCount; ++i) {
+        Capture& capture = _captures[(_nextCapture + CaptureCount - i) % CaptureCount];
+        if(!capture.fence) continue;
+
+        if(!built) {
+            const GLenum status = glClientWaitSync(capture.fence, 0, 0);
+            if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+            build(capture, pool);
+            built = true;
+        }
+
+        glDeleteSync(capture.fence);
+        capture.fence = nullptr;
+    }
+
+    _margin = (cameraMatrix.invertedRigid().translation() - _eye).length();
+    _active = !_levels.empty() && _margin <= MaxCameraDistance;
+    return _active;
+}
+
+void OcclusionCuller::invalidate() {
+    for(Capture& capture: _captures) {
+        if(capture.fence) glDeleteSync(capture.fence);
+        capture.fence = nullptr;
+    }
+
+    _levels.clear();
+    _active = false;
+}
+
+void OcclusionCuller::build(Capture& capture, ThreadPool& pool) {
+    const Vector2i size = capture.image.size();
+
+    /* Sizes rounded up, so the last row and column of a level may cover
+       only one texel of the level below */
+    _levels.clear();
+    std::size_t offset = 0;
+    Vector2i levelSize = size;
+    do {
+        levelSize = Math::max((levelSize + Vector2i{ 1 })/2, Vector2i{ 1 });
+        _levels.push_back({ levelSize, offset });
+        offset += std::size_t(levelSize.product());
+    } while(levelSize != Vector2i{ 1 });
+    _depths.resize(offset);
+
+    GL::Buffer& buffer = capture.image.buffer();
+    const Containers::ArrayView<const Float> depths = Containers::arrayCast<const Float>(
+        buffer.map(0, size.product()*sizeof(Float), GL::Buffer::MapFlag::Read));
+    if(depths.empty()) {
+        _levels.clear();
+        return;
+    }
+
+    const Float* source = depths.data();
+    Vector2i sourceSize = size;
+    for(const Level& level: _levels) {
+        Float* const out = _depths.data() + level.offset;
+        const auto reduce = [&](const std::size_t batch) {
+            const Int end = Math::min(Int(batch + 1)*RowBatchSize, level.size.y());
+            for(Int y = Int(batch)*RowBatchSize; y != end; ++y) {
+                const Float* const row0 = source + 2*y*sourceSize.x();
+                const Float* const row1 = source + Math::min(2*y + 1, sourceSize.y() - 1)*sourceSize.x();
+                for(Int x = 0; x != level.size.x(); ++x) {
+                    const Int x0 = 2*x;
+                    const Int x1 = Math::min(2*x + 1, sourceSize.x() - 1);
+                    out[y*level.size.x() + x] = Math::max(
+                        Math::max(row0[x0], row0[x1]),
+                        Math::max(row1[x0], row1[x1]));
+                }
+            }
+        };
+
+        /* The upper levels are tiny, not worth waking the workers for */
+        const std::size_t batchCount = (level.size.y() + RowBatchSize - 1)/RowBatchSize;
+        if(batchCount == 1) reduce(0);
+        else pool.parallelFor(batchCount, reduce);
+
+        source = out;
+        sourceSize = level.size;
+    }
+
+    buffer.unmap();
+
+    _size = size;
+    _viewProjection = capture.viewProjection;
+    _eye = capture.eye;
+}
+
+bool OcclusionCuller::isOccluded(const Vector3& center, const Float radius) const {
+    if(!_active) return false;
+
+    /* Screen rectangle and nearest depth of the box around the sphere, in
+       the captured frame */
+    const Float r = radius + _margin;
+    Vector2 min{ Constants::inf() };
+    Vector2 max{ -Constants::inf() };
+    Float nearest = Constants::inf();
+    for(UnsignedInt i = 0; i != 8; ++i) {
+        const Vector4 clip = _viewProjection*Vector4{
+            center + Vector3{ i & 1 ? r : -r, i & 2 ? r : -r, i & 4 ? r : -r }, 1.0f };
+
+        /* In front of the near plane, the rectangle has no bounds */
+        if(clip.z() < -clip.w()) return false;
+
+        const Vector3 ndc = clip.xyz()/clip.w();
+        min = Math::min(min, ndc.xy());
+        max = Math::max(max, ndc.xy());
+        nearest = Math::min(nearest, ndc.z());
+    }
+
+    /* What the capture didn't see can't be hidden */
+    if((min < Vector2{ -1.0f }).any() || (max > Vector2{ 1.0f }).any()) return false;
+
+    const Vector2 pixelMin = (min*0.5f + Vector2{ 0.5f })*Vector2{ _size };
+    const Vector2 pixelMax = (max*0.5f + Vector2{ 0.5f })*Vector2{ _size };
+
+    /* A texel of level i covers 2^(i + 1) pixels in each direction. Go up
+       until the rectangle is at most a texel wide, so it touches at most
+       two in each direction. */
+    const Float extent = (pixelMax - pixelMin).max();
+    std::size_t levelIndex = 0;
+    while(levelIndex + 1 < _levels.size() && extent > Float(2 << levelIndex)) ++levelIndex;
+    const Level& level = _levels[levelIndex];
+    const Float texelSize = Float(2 << levelIndex);
+
+    const Vector2i first = Math::clamp(Vector2i{ pixelMin/texelSize }, Vector2i{ 0 }, level.size - Vector2i{ 1 });
+    const Vector2i last = Math::clamp(Vector2i{ pixelMax/texelSize }, Vector2i{ 0 }, level.size - Vector2i{ 1 });
+    Float farthest = 0.0f;
+    for(Int y = first.y(); y <= last.y(); ++y) {
+        for(Int x = first.x(); x <= last.x(); ++x) {
+            farthest = Math::max(farthest, _depths[level.offset + y*level.size.x() + x]);
+        }
+    }
+
+    /* Window depth, with the default depth range */
+    return nearest*0.5f + 0.5f > farthest;
+}
+
+}}
@@ -0,0 +1,133 @@
+#ifndef Magnum_Examples_Shadows_OcclusionCuller_h
+#define Magnum_Examples_Shadows_OcclusionCuller_h
+
+#include <vector>
+#include <Magnum/GL/BufferImage.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/Math/Matrix4.h>
+
+namespace Magnum { namespace Examples {
+
+class ThreadPool;
+
+/**
+ * @brief Occlusion culling against the depth of an earlier frame
+ *
+ * After the main pass, @ref capture() copies the depth buffer into a pixel
+ * pack buffer without waiting for it. At the start of a later frame,
+ * @ref update() takes the newest copy the GPU has finished, which is
+ * usually the one from two frames ago, and builds a hierarchical depth
+ * pyramid from it on the thread pool. Each level is half the size of the
+ * one below and keeps the farthest depth of the texels it covers. A copy
+ * that isn't finished yet is never waited for, the previous pyramid is
+ * kept instead.
+ *
+ * @ref isOccluded() projects a bounding sphere with the camera of the
+ * captured frame, so the objects are reprojected into the old depth rather
+ * than the other way around, which leaves no holes. The sphere is hidden
+ * if its nearest point is behind the farthest depth on the level where
+ * its screen rectangle spans at most two texels in each direction.
+ *
+ * Objects the captured frame didn't see can be visible now, so the test
+ * errs on the side of drawing:
+ *
+ * -    spheres reaching outside the captured view or in front of its near
+ *      plane are always visible,
+ * -    spheres grow by the distance the camera moved since the capture, to
+ *      cover what got uncovered by the change in parallax,
+ * -    once the camera is more than a few units away from where it was,
+ *      nothing is culled until a newer capture is finished,
+ * -    @ref invalidate() drops the pyramid and all pending captures, for
+ *      when objects that may hide others moved.
+ *
+ */
+class OcclusionCuller {
+    public:
+        enum: std::size_t {
+            /* Captures in flight, one more than the frames the GPU is
+               usually behind */
+            CaptureCount = 3
+        };
+
+        explicit OcclusionCuller(NoCreateT) {}
+
+        /** @brief Constructor, creates the pixel pack buffers */
+        explicit OcclusionCuller();
+
+        /** @brief Deletes the fences still pending */
+        ~OcclusionCuller();
+
+        OcclusionCuller(const OcclusionCuller&) = delete;
+        OcclusionCuller(OcclusionCuller&& other) noexcept;
+        OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+        OcclusionCuller& operator=(OcclusionCuller&& other) noexcept;
+
+        /**
+         * @brief Start copying the depth of a finished frame
+         * @param framebuffer     Framebuffer the frame was drawn into, its
+         *      whole viewport is copied
+         * @param projection      Projection matrix it was drawn with
+         * @param cameraMatrix    Camera matrix it was drawn with, expected
+         *      to be rigid
+         *
+         * Expects the framebuffer to be single-sampled.
+         */
+        void capture(GL::AbstractFramebuffer& framebuffer, const Matrix4& projection, const Matrix4& cameraMatrix);
+
+        /**
+         * @brief Build the pyramid from the newest finished capture
+         * @param cameraMatrix    Camera matrix of this frame, expected to
+         *      be rigid
+         * @param pool            Pool the levels are reduced on
+         *
+         * Returns whether @ref isOccluded() can cull anything this frame.
+         */
+        bool update(const Matrix4& cameraMatrix, ThreadPool& pool);
+
+        /** @brief Drop the pyramid and the captures still in flight */
+        void invalidate();
+
+        /** @brief Whether the last @ref update() found a usable pyramid */
+        bool isActive() const { return _active; }
+
+        /**
+         * @brief Whether a world-space bounding sphere is hidden
+         *
+         * Only reads the pyramid, so it can be called from several threads
+         * at once. Always @cpp false @ce if not @ref isActive().
+         */
+        bool isOccluded(const Vector3& center, Float radius) const;
+
+    private:
+        struct Capture {
+            GL::BufferImage2D image{NoCreate};
+            GLsync fence{};
+            Matrix4 viewProjection;
+            Vector3 eye;
+        };
+
+        struct Level {
+            Vector2i size;
+            std::size_t offset;
+        };
+
+        void build(Capture& capture, ThreadPool& pool);
+
+        Capture _captures[CaptureCount];
+        std::size_t _nextCapture{};
+
+        /* All levels one after another, level zero at half the
+           framebuffer size */
+        std::vector<Float> _depths;
+        std::vector<Level> _levels;
+        Vector2i _size;
+        Matrix4 _viewProjection;
+        Vector3 _eye;
+
+        Float _margin{};
+        bool _active{};
+};
+
+}}
+
+#endif
@@ -0,0 +1,55 @@
+#include "Profiler.h"
+
+namespace Magnum { namespace Examples {
+
+Profiler::Profiler() = default;
+
+void Profiler::beginFrame() {
+    ++_frame;
+
+    const std::size_t query = _frame % 2;
+    const std::size_t sample = _frame % HistoryLength;
+    const std::size_t previousSample = (_frame + HistoryLength - 1) % HistoryLength;
+
+    for(PassData& pass: _passes) {
+        /* Carry the last value over if the GPU is behind, so the graph
+           doesn't dip to zero */
+        pass.gpuHistory[sample] = pass.gpuHistory[previousSample];
+        pass.cpuHistory[sample] = 0.0f;
+        pass.gpuTimeNew = false;
+
+        if(pass.queryIssued[query] && pass.queries[query].resultAvailable()) {
+            pass.gpuHistory[sample] = pass.queries[query].result<UnsignedLong>()/1.0e6f;
+            pass.gpuTimeFrame = pass.queryFrame[query];
+            pass.gpuTimeNew = true;
+        }
+        pass.queryIssued[query] = false;
+    }
+}
+
+void Profiler::beginPass(const Pass pass) {
+    PassData& data = _passes[UnsignedInt(pass)];
+    data.queries[_frame % 2].begin();
+    data.cpuBegin = std::chrono::high_resolution_clock::now();
+}
+
+void Profiler::endPass(const Pass pass) {
+    PassData& data = _passes[UnsignedInt(pass)];
+    const auto end = std::chrono::high_resolution_clock::now();
+    data.queries[_frame % 2].end();
+    data.queryIssued[_frame % 2] = true;
+    data.queryFrame[_frame % 2] = _frame;
+
+    data.cpuHistory[_frame % HistoryLength] +=
+        std::chrono::duration<Float, std::milli>(end - data.cpuBegin).count();
+}
+
+Float Profiler::cpuTime(const Pass pass) const {
+    return _passes[UnsignedInt(pass)].cpuHistory[(_frame + HistoryLength - 1) % HistoryLength];
+}
+
+Float Profiler::gpuTime(const Pass pass) const {
+    return _passes[UnsignedInt(pass)].gpuHistory[_frame % HistoryLength];
+}
+
+}}
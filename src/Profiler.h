@@ -0,0 +1,110 @@
+#ifndef Magnum_Examples_Shadows_Profiler_h
+#define Magnum_Examples_Shadows_Profiler_h
+
+#include <chrono>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/TimeQuery.h>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief CPU and GPU time of each render pass over the last frames
+ *
+ * Every pass has two time queries used in alternating frames, and a query
+ * is only read back when it's about to be reused, two frames after it was
+ * issued. By then the GPU is usually done with it; if it isn't, the sample
+ * is dropped instead of waiting, so profiling never stalls the pipeline.
+ *
+ */
+class Profiler {
+    public:
+        enum class Pass: UnsignedInt {
+            Shadow,
+            Main,
+            ImGui
+        };
+
+        enum: std::size_t {
+            PassCount = 3,
+            HistoryLength = 120
+        };
+
+        explicit Profiler();
+
+        /** @brief Start a new frame, collecting finished queries */
+        void beginFrame();
+
+        void beginPass(Pass pass);
+        void endPass(Pass pass);
+
+        /**
+         * @brief CPU time of given pass in the last frames, in milliseconds
+         *
+         * Ring buffer, the oldest sample is at @ref historyOffset().
+         */
+        Containers::ArrayView<const Float> cpuHistory(Pass pass) const {
+            return _passes[UnsignedInt(pass)].cpuHistory;
+        }
+
+        /** @brief GPU time of given pass in the last frames, in milliseconds */
+        Containers::ArrayView<const Float> gpuHistory(Pass pass) const {
+            return _passes[UnsignedInt(pass)].gpuHistory;
+        }
+
+        /**
+         * @brief CPU time of given pass in the previous frame, in milliseconds
+         *
+         * The current frame is still in progress.
+         */
+        Float cpuTime(Pass pass) const;
+
+        /**
+         * @brief Latest GPU time of given pass, in milliseconds
+         *
+         * Measured two frames ago, so a frame behind @ref cpuTime(). If the
+         * GPU was late, it's the previous time carried over, see
+         * @ref isGpuTimeNew().
+         */
+        Float gpuTime(Pass pass) const;
+
+        /**
+         * @brief Whether the last @ref beginFrame() read a new GPU time
+         *
+         * If not, @ref gpuTime() is the same measurement as before.
+         */
+        bool isGpuTimeNew(Pass pass) const {
+            return _passes[UnsignedInt(pass)].gpuTimeNew;
+        }
+
+        /** @brief Frame the latest GPU time was measured in */
+        std::size_t gpuTimeFrame(Pass pass) const {
+            return _passes[UnsignedInt(pass)].gpuTimeFrame;
+        }
+
+        /** @brief Current frame, counted by @ref beginFrame() */
+        std::size_t frame() const { return _frame; }
+
+        std::size_t historyOffset() const { return (_frame + 1) % HistoryLength; }
+
+    private:
+        struct PassData {
+            GL::TimeQuery queries[2]{
+                GL::TimeQuery{ GL::TimeQuery::Target::TimeElapsed },
+                GL::TimeQuery{ GL::TimeQuery::Target::TimeElapsed }
+            };
+            bool queryIssued[2]{};
+            std::size_t queryFrame[2]{};
+            std::size_t gpuTimeFrame{};
+            bool gpuTimeNew{};
+            std::chrono::high_resolution_clock::time_point cpuBegin;
+            Float cpuHistory[HistoryLength]{};
+            Float gpuHistory[HistoryLength]{};
+        };
+
+        PassData _passes[PassCount];
+        std::size_t _frame{};
+};
+
+}}
+
+#endif
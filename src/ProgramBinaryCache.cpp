@@ -0,0 +1,150 @@
+#include "ProgramBinaryCache.h"
+
+#include <cstring>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Utility/Debug.h>
+#include <Corrade/Utility/Directory.h>
+#include <Corrade/Utility/FormatStl.h>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/GL/Shader.h>
+
+#include "Hash.h"
+
+namespace Magnum { namespace Examples {
+
+namespace {
+
+constexpr const char Magic[8]{ 'S', 'H', 'P', 'R', 'O', 'G', 'B', 'N' };
+
+/* Followed by the driver string and the binary */
+struct Header {
+    char magic[8];
+    UnsignedInt format;
+    UnsignedInt driverSize;
+    UnsignedLong sourceHash;
+    UnsignedLong binarySize;
+};
+
+UnsignedLong sourceHash(const std::initializer_list<Containers::Reference<const GL::Shader>> shaders) {
+    UnsignedLong hash = HashSeed;
+    for(const GL::Shader& shader: shaders) {
+        const UnsignedInt type = UnsignedInt(shader.type());
+        hash = hashBytes(hash, Containers::arrayView(&type, 1));
+        for(const std::string& source: shader.sources()) {
+            /* So moving text between two sources changes the hash */
+            const UnsignedLong size = source.size();
+            hash = hashBytes(hash, Containers::arrayView(&size, 1));
+            hash = hashBytes(hash, { source.data(), source.size() });
+        }
+    }
+    return hash;
+}
+
+}
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory) {
+    if(directory.empty()) return;
+
+    GL::Context& context = GL::Context::current();
+    GLint formatCount = 0;
+    if(context.isExtensionSupported<GL::Extensions::ARB::get_program_binary>()) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    }
+    if(!formatCount) {
+        Warning() << "The driver can't store shader programs, compiling them every time";
+        return;
+    }
+
+    if(!Utility::Directory::mkpath(directory)) {
+        Warning() << "Can't create the shader cache directory" << directory;
+        return;
+    }
+
+    _directory = directory;
+    _driver = context.vendorString() + '\n' + context.rendererString() + '\n' +
+              context.versionString();
+}
+
+std::string ProgramBinaryCache::filename(const UnsignedLong sourceHash) const {
+    const UnsignedLong hash = hashBytes(sourceHash, { _driver.data(), _driver.size() });
+    return Utility::Directory::join(_directory, Utility::formatString("{:.16x}.bin", hash));
+}
+
+bool ProgramBinaryCache::load(GL::AbstractShaderProgram& program,
+                              const std::initializer_list<Containers::Reference<const GL::Shader>> shaders) {
+    if(!isEnabled()) return false;
+
+    const UnsignedLong hash = sourceHash(shaders);
+    const std::string file = filename(hash);
+    if(!Utility::Directory::exists(file)) return false;
+
+    const Containers::Array<char> data = Utility::Directory::read(file);
+    Header header;
+    if(data.size() < sizeof(Header)) return false;
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if(std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+       header.sourceHash != hash ||
+       data.size() != sizeof(Header) + header.driverSize + header.binarySize ||
+       _driver.compare(0, std::string::npos, data.data() + sizeof(Header), header.driverSize) != 0) {
+        return false;
+    }
+
+    glProgramBinary(program.id(), header.format,
+                    data.data() + sizeof(Header) + header.driverSize,
+                    GLsizei(header.binarySize));
+
+    /* A driver update that kept the version string can still reject it */
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program.id(), GL_LINK_STATUS, &linked);
+    if(!linked) return false;
+
+    ++_loadedCount;
+    return true;
+}
+
+void ProgramBinaryCache::prepare(GL::AbstractShaderProgram& program) {
+    if(isEnabled()) glProgramParameteri(program.id(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramBinaryCache::save(GL::AbstractShaderProgram& program,
+                              const std::initializer_list<Containers::Reference<const GL::Shader>> shaders) {
+    if(!isEnabled()) return;
+
+    GLint size = 0;
+    glGetProgramiv(program.id(), GL_PROGRAM_BINARY_LENGTH, &size);
+    if(!size) return;
+
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.driverSize = UnsignedInt(_driver.size());
+    header.sourceHash = sourceHash(shaders);
+
+    Containers::Array<char> data{ Containers::NoInit, sizeof(Header) + _driver.size() + std::size_t(size) };
+    GLsizei binarySize = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program.id(), size, &binarySize, &format,
+                       data.data() + sizeof(Header) + _driver.size());
+    header.format = format;
+    header.binarySize = UnsignedLong(binarySize);
+    std::memcpy(data.data(), &header, sizeof(Header));
+    std::memcpy(data.data() + sizeof(Header), _driver.data(), _driver.size());
+
+    /* Written aside and renamed, so a crash in between can't leave a
+       truncated file behind under the final name */
+    const std::string file = filename(header.sourceHash);
+    const std::string temporary = file + ".tmp";
+    if(!Utility::Directory::write(temporary,
+        data.prefix(sizeof(Header) + _driver.size() + std::size_t(binarySize))) ||
+       !Utility::Directory::move(temporary, file)) {
+        Utility::Directory::rm(temporary);
+        Warning() << "Can't store a shader program in" << _directory;
+        return;
+    }
+
+    ++_savedCount;
+}
+
+}}
@@ -0,0 +1,70 @@
+#ifndef Magnum_Examples_Shadows_ProgramBinaryCache_h
+#define Magnum_Examples_Shadows_ProgramBinaryCache_h
+
+#include <initializer_list>
+#include <string>
+#include <Corrade/Containers/Reference.h>
+#include <Magnum/GL/GL.h>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Linked shader programs kept on disk
+ *
+ * Stores what the driver gives back for a linked program, one file per
+ * program in a directory. A file is named and checked by a hash of the
+ * shader sources, defines included, and the driver's vendor, renderer and
+ * version strings, so a program is compiled again whenever either
+ * changes. Loading a stored program skips the GLSL compile and link.
+ *
+ * Needs @gl_extension{ARB,get_program_binary} (OpenGL 4.1) and a driver
+ * supporting at least one binary format, otherwise does nothing.
+ *
+ */
+class ProgramBinaryCache {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * Creates @p directory if it doesn't exist. With an empty
+         * directory, nothing is loaded or stored.
+         */
+        explicit ProgramBinaryCache(const std::string& directory = {});
+
+        bool isEnabled() const { return !_directory.empty(); }
+
+        /**
+         * @brief Link @p program from a stored binary
+         *
+         * The shaders are expected to have all sources added but aren't
+         * compiled or attached. Returns @cpp false @ce if there's no binary
+         * for them or the driver rejects it, the program can then be
+         * compiled and linked as usual.
+         */
+        bool load(GL::AbstractShaderProgram& program, std::initializer_list<Containers::Reference<const GL::Shader>> shaders);
+
+        /**
+         * @brief Ask the driver to keep the binary around
+         *
+         * Call before linking a program that's going to be stored.
+         */
+        void prepare(GL::AbstractShaderProgram& program);
+
+        /** @brief Store a linked program built from @p shaders */
+        void save(GL::AbstractShaderProgram& program, std::initializer_list<Containers::Reference<const GL::Shader>> shaders);
+
+        /** @brief Programs loaded from and stored to disk so far */
+        std::size_t loadedCount() const { return _loadedCount; }
+        std::size_t savedCount() const { return _savedCount; }
+
+    private:
+        std::string filename(UnsignedLong sourceHash) const;
+
+        std::string _directory;
+        std::string _driver;
+        std::size_t _loadedCount{}, _savedCount{};
+};
+
+}}
+
+#endif
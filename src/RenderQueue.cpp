@@ -0,0 +1,74 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/Math/Functions.h>
+
+namespace Magnum { namespace Examples {
+
+namespace {
+
+/* A shader or mesh different from the previous draw's means a bind */
+std::size_t bindChanges(const std::vector<DrawPacket>& packets) {
+    std::size_t changes = 0;
+    const GL::AbstractShaderProgram* shader = nullptr;
+    const Model* model = nullptr;
+    for(const DrawPacket& packet: packets) {
+        if(packet.shader != shader) ++changes;
+        if(packet.model != model) ++changes;
+        shader = packet.shader;
+        model = packet.model;
+    }
+    return changes;
+}
+
+}
+
+UnsignedLong RenderQueue::key(const GL::AbstractShaderProgram& shader,
+                              const UnsignedInt meshId,
+                              const Float depth) const {
+    /* Bits of a non-negative float compare the same as the float itself.
+       Anything behind the camera is as near as it gets. */
+    const Float clampedDepth = Math::max(depth, 0.0f);
+    UnsignedInt depthBits;
+    std::memcpy(&depthBits, &clampedDepth, sizeof(depthBits));
+
+    const UnsignedLong shaderBits = shader.id() & 0xffff;
+    const UnsignedLong meshBits = meshId & 0xffff;
+
+    /* 16 bits shader | 16 bits mesh | 32 bits depth, or with depth and
+       mesh swapped */
+    return _order == Order::State ?
+        shaderBits << 48 | meshBits << 32 | depthBits :
+        shaderBits << 48 | UnsignedLong(depthBits) << 16 | meshBits;
+}
+
+void RenderQueue::add(GL::AbstractShaderProgram& shader,
+                      Model& model,
+                      const UnsignedInt meshId,
+                      const Containers::ArrayView<const Matrix4> transformations,
+                      const Float depth) {
+    if(transformations.empty()) return;
+
+    _packets.push_back({ key(shader, meshId, depth), &shader, &model, transformations });
+}
+
+void RenderQueue::submit(DrawStatistics& statistics) {
+    statistics.unsortedBindChanges += _unsortedBindChanges;
+    _unsortedBindChanges = 0;
+
+    std::sort(_packets.begin(), _packets.end(),
+              [](const DrawPacket& a, const DrawPacket& b) {
+                  return a.key < b.key;
+              });
+    statistics.bindChanges += bindChanges(_packets);
+
+    for(const DrawPacket& packet: _packets) {
+        packet.model->drawInstances(*packet.shader, packet.transformations, statistics);
+    }
+
+    _packets.clear();
+}
+
+}}
@@ -0,0 +1,101 @@
+#ifndef Magnum_Examples_Shadows_RenderQueue_h
+#define Magnum_Examples_Shadows_RenderQueue_h
+
+#include <vector>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/GL.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include "Model.h"
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Instanced draw waiting in a @ref RenderQueue
+ *
+ * The key packs the state the draw needs together with its depth, so
+ * sorting the keys as plain integers orders the draws.
+ */
+struct DrawPacket {
+    UnsignedLong key;
+    GL::AbstractShaderProgram* shader;
+    Model* model;
+    Containers::ArrayView<const Matrix4> transformations;
+};
+
+/**
+ * @brief Draws of one pass, sorted before submission
+ *
+ * Packets can be added in any order. @ref submit() sorts them by their
+ * 64-bit key and draws them, so consecutive draws share as much state as
+ * possible. The packet storage is kept between passes.
+ *
+ */
+class RenderQueue {
+    public:
+        enum class Order: UnsignedByte {
+            /**
+             * Shader, then mesh, then depth. For passes that are bound by
+             * the state changes, like depth-only shadow rendering.
+             */
+            State,
+
+            /**
+             * Shader, then depth front to back, then mesh. Nearer draws
+             * fill the depth buffer first, so fragments behind them get
+             * rejected before shading.
+             */
+            FrontToBack
+        };
+
+        explicit RenderQueue(Order order): _order{order} {}
+
+        Order order() const { return _order; }
+
+        /**
+         * @brief Queue an instanced draw
+         * @param shader            Shader to draw with, its uniforms set
+         *      before @ref submit()
+         * @param model             Model to draw
+         * @param meshId            Small number identifying the mesh,
+         *      only the lower 16 bits are used
+         * @param transformations   Instance transformations, have to stay
+         *      alive until @ref submit()
+         * @param depth             Distance of the nearest instance from
+         *      the camera
+         */
+        void add(GL::AbstractShaderProgram& shader, Model& model, UnsignedInt meshId, Containers::ArrayView<const Matrix4> transformations, Float depth);
+
+        std::size_t size() const { return _packets.size(); }
+
+        /**
+         * @brief Record the bind changes of the queued objects unsorted
+         *
+         * How many shader and mesh changes drawing the objects one by one,
+         * in the order culling found them, would take. The packets are
+         * already grouped by model, so their order can't tell. See
+         * @ref DrawList::unsortedBindChanges().
+         */
+        void addUnsortedBindChanges(std::size_t count) {
+            _unsortedBindChanges += count;
+        }
+
+        /**
+         * @brief Sort and draw all queued packets, then clear the queue
+         *
+         * Adds the draws, shader and mesh changes after sorting and the
+         * ones recorded by @ref addUnsortedBindChanges() to @p statistics.
+         */
+        void submit(DrawStatistics& statistics);
+
+    private:
+        UnsignedLong key(const GL::AbstractShaderProgram& shader, UnsignedInt meshId, Float depth) const;
+
+        Order _order;
+        std::vector<DrawPacket> _packets;
+        std::size_t _unsortedBindChanges{};
+};
+
+}}
+
+#endif
@@ -0,0 +1,246 @@
+#include "SceneLoader.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Utility/Directory.h>
+#include <Corrade/Utility/String.h>
+#include <Magnum/Mesh.h>
+#include <Magnum/MeshTools/GenerateNormals.h>
+#include <Magnum/Trade/MeshData.h>
+#include <Magnum/Trade/ObjectData3D.h>
+#include <Magnum/Trade/SceneData.h>
+
+#include "Hash.h"
+#include "ShadowsScene.h"
+
+namespace Magnum { namespace Examples {
+
+namespace {
+
+std::string importerFor(const std::string& filename) {
+    const std::string lowercase = Utility::String::lowercase(filename);
+    if(Utility::String::endsWith(lowercase, ".obj")) return "ObjImporter";
+    if(Utility::String::endsWith(lowercase, ".gltf") ||
+       Utility::String::endsWith(lowercase, ".glb")) return "TinyGltfImporter";
+    return "AnySceneImporter";
+}
+
+/* A glTF usually keeps its buffers in files next to it, which the hash of
+   the file itself wouldn't notice changing */
+bool isSelfContained(const std::string& filename) {
+    return !Utility::String::endsWith(Utility::String::lowercase(filename), ".gltf");
+}
+
+/* Fills in what compactMesh() needs but the file doesn't have. Without a
+   key, the cache hashes the resulting streams instead. */
+bool prepare(const Trade::MeshData& meshData, MeshCache& cache,
+             const Containers::Optional<UnsignedLong>& key, CompactMeshView& out) {
+    if(meshData.primitive() != MeshPrimitive::Triangles ||
+       !meshData.hasAttribute(Trade::MeshAttribute::Position)) {
+        Warning() << "Skipping a mesh that isn't a triangle list with positions";
+        return false;
+    }
+
+    const Containers::Array<Vector3> positions = meshData.positions3DAsArray();
+
+    Containers::Array<UnsignedInt> indices;
+    if(meshData.isIndexed()) {
+        indices = meshData.indicesAsArray();
+    } else {
+        indices = Containers::Array<UnsignedInt>{ Containers::NoInit, positions.size() };
+        for(std::size_t i = 0; i != indices.size(); ++i) indices[i] = UnsignedInt(i);
+    }
+
+    const Containers::Array<Vector3> normals =
+        meshData.hasAttribute(Trade::MeshAttribute::Normal) ?
+            meshData.normalsAsArray() :
+            MeshTools::generateSmoothNormals(Containers::arrayView(indices),
+                                             Containers::arrayView(positions));
+
+    out = key ? cache.add(*key, positions, normals, indices) :
+                cache.get(positions, normals, indices);
+    return true;
+}
+
+}
+
+SceneLoader::SceneLoader(const std::string& filename,
+                         const std::size_t workerCount,
+                         const std::string& meshCache):
+    _filename{filename}, _workerCount{workerCount}, _cache{meshCache}
+{
+    _importer = _manager.loadAndInstantiate(importerFor(filename));
+    if(!_importer) {
+        _failed = _done = true;
+        return;
+    }
+
+    if(_workerCount) _thread = std::thread{ &SceneLoader::run, this };
+}
+
+SceneLoader::~SceneLoader() {
+    _cancelled = true;
+    if(_thread.joinable()) _thread.join();
+}
+
+std::size_t SceneLoader::meshCount() const {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _meshCount;
+}
+
+std::size_t SceneLoader::finishedCount() const {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _uploadedCount + _skippedCount;
+}
+
+bool SceneLoader::isFailed() const {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _failed;
+}
+
+void SceneLoader::run() {
+    if(!open()) return;
+
+    /* The first worker opened the file, the others start only now when
+       there's something to do */
+    std::vector<std::thread> helpers;
+    for(std::size_t i = 1; i < _workerCount; ++i) {
+        helpers.emplace_back([this]() { while(processNext()) {} });
+    }
+
+    while(processNext()) {}
+    for(std::thread& helper: helpers) helper.join();
+}
+
+bool SceneLoader::open() {
+    /* Cached meshes are then found before importing them */
+    if(_cache.isEnabled() && isSelfContained(_filename)) {
+        const Containers::Array<char> data = Utility::Directory::read(_filename);
+        _fileHash = hashBytes(HashSeed, data);
+    }
+
+    if(!_importer->openFile(_filename)) {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _failed = _done = true;
+        return false;
+    }
+
+    _instances.assign(_importer->meshCount(), {});
+    if(_importer->defaultScene() != -1) {
+        const Containers::Optional<Trade::SceneData> scene =
+            _importer->scene(_importer->defaultScene());
+        if(scene) for(const UnsignedInt object: scene->children3D()) {
+            addInstances(object, Matrix4{});
+        }
+    } else {
+        for(std::vector<Matrix4>& instances: _instances) {
+            instances.push_back(Matrix4{});
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{ _mutex };
+    _meshCount = _importer->meshCount();
+    _opened = true;
+    _done = !_meshCount;
+    return true;
+}
+
+void SceneLoader::addInstances(const UnsignedInt object,
+                               const Matrix4& parentTransformation) {
+    const Containers::Pointer<Trade::ObjectData3D> data = _importer->object3D(object);
+    if(!data) return;
+
+    const Matrix4 transformation = parentTransformation*data->transformation();
+    if(data->instanceType() == Trade::ObjectInstanceType3D::Mesh &&
+       data->instance() != -1) {
+        _instances[data->instance()].push_back(transformation);
+    }
+
+    for(const UnsignedInt child: data->children()) {
+        addInstances(child, transformation);
+    }
+}
+
+bool SceneLoader::processNext() {
+    if(_cancelled) return false;
+
+    UnsignedInt id;
+    {
+        std::lock_guard<std::mutex> lock{ _importerMutex };
+        if(_nextMesh == _importer->meshCount()) return false;
+        id = _nextMesh++;
+    }
+
+    /* A hit skips the import and everything prepare() does */
+    Containers::Optional<UnsignedLong> key;
+    if(_fileHash) key = MeshCache::fileMeshKey(*_fileHash, id);
+    LoadedMesh loaded;
+    bool prepared = key && _cache.find(*key, loaded.data);
+    if(!prepared) {
+        Containers::Optional<Trade::MeshData> meshData;
+        {
+            std::lock_guard<std::mutex> lock{ _importerMutex };
+            meshData = _importer->mesh(id);
+        }
+        prepared = meshData && prepare(*meshData, _cache, key, loaded.data);
+    }
+
+    std::lock_guard<std::mutex> lock{ _mutex };
+    if(prepared && !_instances[id].empty()) {
+        loaded.transformations = std::move(_instances[id]);
+        _ready.push_back(std::move(loaded));
+    } else ++_skippedCount;
+    if(++_processedCount == _meshCount) _done = true;
+    return true;
+}
+
+bool SceneLoader::upload(ShadowsScene& scene,
+                         const std::chrono::nanoseconds budget) {
+    const auto begin = std::chrono::steady_clock::now();
+
+    /* Without workers, as much of their job as fits into a frame */
+    if(!_workerCount && !_done) {
+        if(!_opened) open();
+        else processNext();
+    }
+
+    for(;;) {
+        LoadedMesh mesh;
+        {
+            std::lock_guard<std::mutex> lock{ _mutex };
+
+            /* Models added later would otherwise move the ones the
+               drawables point to */
+            if(_opened && !_reserved) {
+                scene.reserveModels(_meshCount);
+                _reserved = true;
+            }
+
+            if(_ready.empty()) {
+                if(!_done) return true;
+
+                /* Nothing points into the cache anymore */
+                if(!_failed && !_saved) {
+                    _cache.save();
+                    _saved = true;
+                }
+                return false;
+            }
+            mesh = std::move(_ready.front());
+            _ready.pop_front();
+        }
+
+        Model& model = scene.addModel(mesh.data);
+        for(const Matrix4& transformation: mesh.transformations) {
+            scene.createSceneObject(model)->setTransformation(transformation);
+        }
+        ++_uploadedCount;
+
+        if(std::chrono::steady_clock::now() - begin >= budget) {
+            std::lock_guard<std::mutex> lock{ _mutex };
+            if(!_done || !_ready.empty()) return true;
+        }
+    }
+}
+
+}}
@@ -0,0 +1,130 @@
+#ifndef Magnum_Examples_Shadows_SceneLoader_h
+#define Magnum_Examples_Shadows_SceneLoader_h
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Corrade/PluginManager/Manager.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Trade/AbstractImporter.h>
+
+#include "MeshCache.h"
+
+namespace Magnum { namespace Examples {
+
+class ShadowsScene;
+
+/**
+ * @brief Streams meshes from a file into a scene
+ *
+ * Opening the file, importing the meshes, computing their bounds and the
+ * rest of @ref compactMesh() happens on worker threads. The thread owning
+ * the GL context then calls @ref upload() every frame, which adds what's
+ * ready to the scene until a time budget runs out, so a large file
+ * doesn't stall the frames while it's coming in.
+ *
+ * Every mesh becomes a model, placed as a static caster and receiver
+ * wherever the file's default scene references it. Files without a scene,
+ * like OBJ, get each mesh placed once, untransformed. Missing normals are
+ * generated.
+ *
+ */
+class SceneLoader {
+    public:
+        /**
+         * @brief Start loading a file
+         * @param filename      OBJ file, or glTF if the TinyGltfImporter
+         *      plugin is available
+         * @param workerCount   Threads importing and preprocessing the
+         *      meshes. With zero, @ref upload() does one mesh at a time on
+         *      the calling thread.
+         * @param meshCache     File to take preprocessed meshes from and
+         *      save them to once everything is uploaded, see
+         *      @ref MeshCache
+         */
+        explicit SceneLoader(const std::string& filename, std::size_t workerCount = 2, const std::string& meshCache = {});
+
+        /** @brief Stops after the meshes being processed and joins the workers */
+        ~SceneLoader();
+
+        SceneLoader(const SceneLoader&) = delete;
+        SceneLoader& operator=(const SceneLoader&) = delete;
+
+        /** @brief Meshes in the file, zero until it's opened */
+        std::size_t meshCount() const;
+
+        /** @brief Meshes added to the scene so far */
+        std::size_t uploadedCount() const { return _uploadedCount; }
+
+        /**
+         * @brief Meshes that are done, added to the scene or skipped
+         *
+         * Meshes that fail to import, aren't triangle lists with positions
+         * or aren't referenced by the file's scene are skipped. Equal to
+         * @ref meshCount() once everything is loaded.
+         */
+        std::size_t finishedCount() const;
+
+        /** @brief Whether the file couldn't be opened */
+        bool isFailed() const;
+
+        /**
+         * @brief Add meshes that are ready to the scene
+         *
+         * Adds at least one if there's any, and more until @p budget is
+         * spent. Expects the scene to have no objects yet, or room for all
+         * the meshes, see @ref ShadowsScene::reserveModels(). Returns
+         * @cpp false @ce once everything is added or loading failed.
+         */
+        bool upload(ShadowsScene& scene, std::chrono::nanoseconds budget);
+
+    private:
+        /* Points into _cache */
+        struct LoadedMesh {
+            CompactMeshView data;
+            std::vector<Matrix4> transformations;
+        };
+
+        void run();
+        bool open();
+        void addInstances(UnsignedInt object, const Matrix4& parentTransformation);
+        bool processNext();
+
+        PluginManager::Manager<Trade::AbstractImporter> _manager;
+        std::string _filename;
+        std::size_t _workerCount;
+        std::atomic<bool> _cancelled{};
+        MeshCache _cache;
+
+        /* Filled when the file is opened, before the workers start. The
+           hash is there only if the meshes are cached by it. */
+        std::vector<std::vector<Matrix4>> _instances;
+        Containers::Optional<UnsignedLong> _fileHash;
+
+        /* The importer can import only one thing at a time */
+        std::mutex _importerMutex;
+        Containers::Pointer<Trade::AbstractImporter> _importer;
+        UnsignedInt _nextMesh{};
+
+        /* Shared between the workers and upload() */
+        mutable std::mutex _mutex;
+        std::deque<LoadedMesh> _ready;
+        std::size_t _meshCount{}, _processedCount{}, _skippedCount{};
+        bool _opened{}, _failed{}, _done{};
+
+        /* Touched only by upload() */
+        bool _reserved{}, _saved{};
+        std::size_t _uploadedCount{};
+
+        std::thread _thread;
+};
+
+}}
+
+#endif
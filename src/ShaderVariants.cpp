@@ -0,0 +1,40 @@
+#include "ShaderVariants.h"
+
+#include <initializer_list>
+#include <Magnum/Math/Functions.h>
+
+#include "Uniforms.h"
+
+namespace Magnum { namespace Examples {
+
+ShaderVariants::ShaderVariants(const std::string& binaryCacheDirectory):
+    _binaryCache{ binaryCacheDirectory } {}
+
+ShadowCasterShader& ShaderVariants::caster() {
+    if(!_caster.id()) _caster = ShadowCasterShader{ &_binaryCache };
+    return _caster;
+}
+
+ShadowReceiverShader& ShaderVariants::receiver(const Int shadowLevelCount,
+                                               const ShadowMode mode) {
+    const std::string defines = ShadowReceiverShader::defines(shadowLevelCount, mode);
+    auto found = _receivers.find(defines);
+    if(found == _receivers.end()) {
+        found = _receivers.emplace(defines, ShadowReceiverShader{ shadowLevelCount, mode, &_binaryCache }).first;
+    }
+    return found->second;
+}
+
+std::size_t ShaderVariants::precompile(const Int shadowLevelCount) {
+    const std::size_t count = variantCount();
+    caster();
+    for(const ShadowMode mode: { ShadowMode::Hard, ShadowMode::Variance }) {
+        for(Int levels = Math::max(shadowLevelCount - 1, 1);
+            levels <= Math::min(shadowLevelCount + 1, MaxShadowMapLevels); ++levels) {
+            receiver(levels, mode);
+        }
+    }
+    return variantCount() - count;
+}
+
+}}
@@ -0,0 +1,61 @@
+#ifndef Magnum_Examples_Shadows_ShaderVariants_h
+#define Magnum_Examples_Shadows_ShaderVariants_h
+
+#include <string>
+#include <unordered_map>
+
+#include "ProgramBinaryCache.h"
+#include "ShadowCasterShader.h"
+#include "ShadowReceiverShader.h"
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Caster and receiver shaders for every configuration in use
+ *
+ * Each variant is looked up by the defines it's compiled with and created
+ * when it's asked for the first time, or ahead of that by
+ * @ref precompile(). It stays around afterwards, so
+ * switching back to it is free. Linked programs go through a
+ * @ref ProgramBinaryCache, which turns creating a variant seen in an
+ * earlier run into loading its binary. Needs a current GL context.
+ */
+class ShaderVariants {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * Linked programs are stored in @p binaryCacheDirectory, nowhere
+         * if it's empty.
+         */
+        explicit ShaderVariants(const std::string& binaryCacheDirectory = {});
+
+        /** @brief The caster shader, the same in both modes */
+        ShadowCasterShader& caster();
+        ShadowReceiverShader& receiver(Int shadowLevelCount, ShadowMode mode);
+
+        /**
+         * @brief Create the variants one setting change away
+         *
+         * The caster and receivers of both modes, for
+         * @p shadowLevelCount and one level less and more, within
+         * @ref MaxShadowMapLevels. Variants that exist already are
+         * skipped. Returns how many got created.
+         */
+        std::size_t precompile(Int shadowLevelCount);
+
+        std::size_t variantCount() const { return (_caster.id() ? 1 : 0) + _receivers.size(); }
+        const ProgramBinaryCache& binaryCache() const { return _binaryCache; }
+
+    private:
+        ProgramBinaryCache _binaryCache;
+
+        ShadowCasterShader _caster{NoCreate};
+
+        /* Node-based, so the references given out stay valid */
+        std::unordered_map<std::string, ShadowReceiverShader> _receivers;
+};
+
+}}
+
+#endif
@@ -0,0 +1,190 @@
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/GL/Sampler.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Matrix4.h>
+
+namespace Magnum { namespace Examples {
+
+ShadowAtlas::ShadowAtlas(const Int size, const Int minTileSize)
+    : _size{size}, _minTileSize{minTileSize} {
+    CORRADE_INTERNAL_ASSERT(Math::isPowerOfTwo(UnsignedInt(size)) &&
+                            Math::isPowerOfTwo(UnsignedInt(minTileSize)) &&
+                            minTileSize <= size);
+
+    _texture = GL::Texture2D{};
+    _texture
+
+        // Needs to be DepthComponent24 - not 8, 16 or 32 - unsure why
+        .setStorage(1, GL::TextureFormat::DepthComponent24, Vector2i{ size })
+
+        // Required, else OpenGL will tell you..
+        //    Program undefined behavior warning:
+        //    Sampler object 0 does not have depth compare enabled.
+        //    It is being used with depth texture 2, by a program
+        //    that samples it with a shadow sampler.
+        //    This is undefined behavior.
+        .setCompareFunction(GL::SamplerCompareFunction::LessOrEqual)
+        .setCompareMode(GL::SamplerCompareMode::CompareRefToTexture)
+        .setMinificationFilter(GL::SamplerFilter::Linear, GL::SamplerMipmap::Base)
+        .setMagnificationFilter(GL::SamplerFilter::Linear)
+        .setWrapping(GL::SamplerWrapping::ClampToEdge)
+    ;
+
+    _framebuffer = GL::Framebuffer{ { {}, Vector2i{ size } } };
+    _framebuffer.attachTexture(GL::Framebuffer::BufferAttachment::Depth,
+                               _texture, 0)
+                .mapForDraw(GL::Framebuffer::DrawAttachment::None)
+                .clear(GL::FramebufferClear::Depth);
+
+    CORRADE_INTERNAL_ASSERT(
+        _framebuffer.checkStatus(GL::FramebufferTarget::Draw) ==
+        GL::Framebuffer::Status::Complete
+    );
+
+    /* Initially the only free tile is the whole atlas */
+    _freeTiles.resize(levelForSize(minTileSize) + 1);
+    _freeTiles[0].push_back({});
+}
+
+Int ShadowAtlas::levelForSize(const Int tileSize) const {
+    Int level = 0;
+    while((_size >> (level + 1)) >= tileSize) ++level;
+    return level;
+}
+
+Containers::Optional<Range2Di> ShadowAtlas::allocate(const Int tileSize) {
+    if(tileSize > _size) return Containers::NullOpt;
+
+    const Int level = levelForSize(Math::max(tileSize, _minTileSize));
+
+    /* Find the smallest free tile that's large enough */
+    Int freeLevel = level;
+    while(freeLevel >= 0 && _freeTiles[freeLevel].empty()) --freeLevel;
+    if(freeLevel < 0) return Containers::NullOpt;
+
+    Vector2i offset = _freeTiles[freeLevel].back();
+    _freeTiles[freeLevel].pop_back();
+
+    /* Split it down to the requested size, keeping the first quadrant and
+       putting the other three back to the free list */
+    for(; freeLevel != level; ++freeLevel) {
+        const Int half = _size >> (freeLevel + 1);
+        _freeTiles[freeLevel + 1].push_back(offset + Vector2i{half, 0});
+        _freeTiles[freeLevel + 1].push_back(offset + Vector2i{0, half});
+        _freeTiles[freeLevel + 1].push_back(offset + Vector2i{half, half});
+    }
+
+    const Int size = _size >> level;
+    _allocatedArea += Long(size) * size;
+    return Range2Di::fromSize(offset, Vector2i{ size });
+}
+
+void ShadowAtlas::release(const Range2Di& tile) {
+    Int level = levelForSize(tile.sizeX());
+    Vector2i offset = tile.min();
+    _allocatedArea -= Long(tile.sizeX()) * tile.sizeX();
+
+    /* Merge with the siblings for as long as they're all free */
+    for(; level != 0; --level) {
+        const Int parentSize = _size >> (level - 1);
+        const Int half = parentSize / 2;
+        const Vector2i parent { offset.x() - offset.x() % parentSize,
+                                offset.y() - offset.y() % parentSize };
+
+        std::vector<Vector2i>& freeTiles = _freeTiles[level];
+        const Vector2i siblings[] {
+            parent,
+            parent + Vector2i{half, 0},
+            parent + Vector2i{0, half},
+            parent + Vector2i{half, half}
+        };
+
+        bool allFree = true;
+        for(const Vector2i& sibling: siblings) {
+            if(sibling != offset &&
+               std::find(freeTiles.begin(), freeTiles.end(), sibling) == freeTiles.end()) {
+                allFree = false;
+                break;
+            }
+        }
+        if(!allFree) break;
+
+        for(const Vector2i& sibling: siblings) {
+            if(sibling == offset) continue;
+            freeTiles.erase(std::find(freeTiles.begin(), freeTiles.end(), sibling));
+        }
+
+        offset = parent;
+    }
+
+    _freeTiles[level].push_back(offset);
+}
+
+Int ShadowAtlas::tileSize(const Float priority, const Int maxTileSize, const Int minTileSize) {
+    const Float target = Math::clamp(priority, 0.0f, 1.0f) * Float(maxTileSize);
+    Int tileSize = minTileSize;
+    while(tileSize * 2 <= maxTileSize && Float(tileSize * 2) <= target) {
+        tileSize *= 2;
+    }
+    return tileSize;
+}
+
+Int ShadowAtlas::fittingSize(const Containers::ArrayView<const Int> tileSizes,
+                             const Int minTileSize) {
+    Int size = minTileSize;
+    Long area = 0;
+    for(const Int tileSize: tileSizes) {
+        Int rounded = minTileSize;
+        while(rounded < tileSize) rounded *= 2;
+        size = Math::max(size, rounded);
+        area += Long(rounded) * rounded;
+    }
+
+    while(Long(size) * size < area) size *= 2;
+    return size;
+}
+
+std::size_t ShadowAtlas::memoryUsage() const {
+    return std::size_t(_size)*std::size_t(_size)*4;
+}
+
+Float ShadowAtlas::usage() const {
+    return Float(Double(_allocatedArea) / (Double(_size) * _size));
+}
+
+void ShadowAtlas::setCompareEnabled(const bool enabled) {
+    _texture.setCompareMode(enabled ? GL::SamplerCompareMode::CompareRefToTexture :
+                                      GL::SamplerCompareMode::None);
+}
+
+Matrix4 ShadowAtlas::tileMatrix(const Range2Di& tile) const {
+    const Vector2 offset = Vector2{ tile.min() } / Float(_size);
+    const Vector2 scale = Vector2{ tile.size() } / Float(_size);
+    return Matrix4::translation({ offset, 0.0f })
+         * Matrix4::scaling({ scale, 1.0f });
+}
+
+Vector4 ShadowAtlas::uvRect(const Range2Di& tile) const {
+    const Vector2 min = Vector2{ tile.min() + Vector2i{ 1 } } / Float(_size);
+    const Vector2 max = Vector2{ tile.max() - Vector2i{ 1 } } / Float(_size);
+    return { min.x(), min.y(), max.x(), max.y() };
+}
+
+void ShadowAtlas::bindTile(const Range2Di& tile, const bool clear) {
+    _framebuffer.setViewport(tile)
+                .bind();
+
+    if(clear) {
+        /* Clearing ignores the viewport, limit it with the scissor */
+        GL::Renderer::enable(GL::Renderer::Feature::ScissorTest);
+        GL::Renderer::setScissor(tile);
+        _framebuffer.clear(GL::FramebufferClear::Depth);
+        GL::Renderer::disable(GL::Renderer::Feature::ScissorTest);
+    }
+}
+
+}}
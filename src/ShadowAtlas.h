@@ -0,0 +1,131 @@
+#ifndef Magnum_Examples_Shadows_ShadowAtlas_h
+#define Magnum_Examples_Shadows_ShadowAtlas_h
+
+#include <vector>
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/Optional.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Math/Vector4.h>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief A single depth texture shared by the shadow maps of many lights
+ *
+ * Hands out square power-of-two tiles using a quadtree buddy allocator.
+ * A freed tile is merged back with its three siblings once they're all
+ * free, so tiles of different sizes can come and go without fragmenting
+ * the atlas. All tiles are rendered through the one framebuffer, with the
+ * viewport and scissor set to the tile, and receivers sample the one
+ * texture with per-tile UV rectangles.
+ *
+ */
+class ShadowAtlas {
+    public:
+        explicit ShadowAtlas(NoCreateT) {}
+
+        /**
+         * @brief Constructor
+         * @param size          Atlas width and height, power of two
+         * @param minTileSize   Smallest tile that can be allocated, power
+         *      of two
+         */
+        explicit ShadowAtlas(Int size, Int minTileSize = 64);
+
+        Int size() const { return _size; }
+
+        /**
+         * @brief Allocate a tile
+         *
+         * The size is rounded up to the next power of two. Returns
+         * @ref Containers::NullOpt if there's no free space large enough.
+         */
+        Containers::Optional<Range2Di> allocate(Int tileSize);
+
+        /** @brief Return a tile previously returned by @ref allocate() */
+        void release(const Range2Di& tile);
+
+        /**
+         * @brief Tile size for given priority
+         *
+         * Scales @p maxTileSize by @p priority, which is expected to be in
+         * range @f$ [0, 1] @f$ (for example the fraction of the screen a
+         * light affects), and rounds down to a power of two not smaller than
+         * @p minTileSize.
+         */
+        static Int tileSize(Float priority, Int maxTileSize, Int minTileSize = 64);
+
+        /**
+         * @brief Smallest atlas size that fits given tiles
+         *
+         * The sizes are rounded up to powers of two the same way as in
+         * @ref allocate(). Allocated from the largest to the smallest, the
+         * tiles leave no gaps, so the atlas only needs to be as large as
+         * the biggest of them and have enough area for all.
+         */
+        static Int fittingSize(Containers::ArrayView<const Int> tileSizes, Int minTileSize = 64);
+
+        /** @brief Fraction of the atlas area that is allocated */
+        Float usage() const;
+
+        /**
+         * @brief Estimated GPU memory used by the texture, in bytes
+         *
+         * Drivers store 24-bit depth padded to four bytes per texel.
+         */
+        std::size_t memoryUsage() const;
+
+        /**
+         * @brief Enable depth comparison
+         *
+         * Enabled by default, for sampling the atlas with a shadow sampler.
+         * Has to be disabled for reading the depth values themselves.
+         */
+        void setCompareEnabled(bool enabled);
+
+        /**
+         * @brief Matrix that maps the unit square to given tile
+         *
+         * Multiply a shadow matrix producing @f$ [0, 1] @f$ texture
+         * coordinates with this to get coordinates in the atlas.
+         */
+        Matrix4 tileMatrix(const Range2Di& tile) const;
+
+        /**
+         * @brief Texture coordinate rectangle of given tile
+         *
+         * As min x, min y, max x, max y. Shrunk by a texel on each side so
+         * filtered lookups that pass the range test don't bleed into
+         * neighboring tiles.
+         */
+        Vector4 uvRect(const Range2Di& tile) const;
+
+        /**
+         * @brief Bind the framebuffer for rendering into given tile
+         *
+         * Sets the viewport to the tile. If @p clear is set, also clears the
+         * depth of the tile, leaving the rest of the atlas intact.
+         */
+        void bindTile(const Range2Di& tile, bool clear);
+
+        GL::Texture2D& texture() { return _texture; }
+        GL::Framebuffer& framebuffer() { return _framebuffer; }
+
+    private:
+        Int levelForSize(Int tileSize) const;
+
+        GL::Texture2D _texture{NoCreate};
+        GL::Framebuffer _framebuffer{NoCreate};
+        Int _size{}, _minTileSize{};
+        Long _allocatedArea{};
+
+        /* Offsets of free tiles, level 0 being the whole atlas and each next
+           level halving the tile size */
+        std::vector<std::vector<Vector2i>> _freeTiles;
+};
+
+}}
+
+#endif
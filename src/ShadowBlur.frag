@@ -0,0 +1,45 @@
+uniform highp sampler2D sourceTexture;
+
+/* Added to the fragment position to get the source texel, and the range
+   all reads are clamped to. Taps don't leave the rendered part of the
+   source that way, and pixels past its edge repeat the edge. */
+uniform ivec2 sourceOffset;
+uniform ivec4 sourceBounds;
+
+/* Unit step along one axis */
+uniform ivec2 direction;
+
+layout(location = 0) out highp vec2 moments;
+
+/* Half of a 9-tap Gaussian */
+const float weights[5] = float[](0.2270270270, 0.1945945946, 0.1216216216,
+                                 0.0540540541, 0.0162162162);
+
+#ifdef DEPTH_SOURCE
+/* Depth and its square. The latter is widened by how much the depth varies
+   over the texel, which keeps sloped surfaces from shadowing themselves. */
+highp vec2 sourceMoments(ivec2 texel) {
+    highp float depth = texelFetch(sourceTexture, texel, 0).r;
+    highp float dx = texelFetch(sourceTexture, min(texel + ivec2(1, 0), sourceBounds.zw), 0).r - depth;
+    highp float dy = texelFetch(sourceTexture, min(texel + ivec2(0, 1), sourceBounds.zw), 0).r - depth;
+    return vec2(depth, depth * depth + 0.25 * (dx * dx + dy * dy));
+}
+#else
+highp vec2 sourceMoments(ivec2 texel) {
+    return texelFetch(sourceTexture, texel, 0).rg;
+}
+#endif
+
+void main() {
+    ivec2 center = clamp(ivec2(gl_FragCoord.xy) + sourceOffset,
+                         sourceBounds.xy, sourceBounds.zw);
+
+    highp vec2 sum = sourceMoments(center) * weights[0];
+    for (int i = 1; i < 5; i++) {
+        ivec2 a = clamp(center + direction * i, sourceBounds.xy, sourceBounds.zw);
+        ivec2 b = clamp(center - direction * i, sourceBounds.xy, sourceBounds.zw);
+        sum += (sourceMoments(a) + sourceMoments(b)) * weights[i];
+    }
+
+    moments = sum;
+}
@@ -0,0 +1,55 @@
+#include "ShadowBlurShader.h"
+
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Math/Vector4.h>
+
+namespace Magnum { namespace Examples {
+
+ShadowBlurShader::ShadowBlurShader(const Source source) {
+    MAGNUM_ASSERT_GL_VERSION_SUPPORTED(GL::Version::GL330);
+
+    const Utility::Resource rs{"shadow-data"};
+
+    GL::Shader vert{ GL::Version::GL330, GL::Shader::Type::Vertex };
+    GL::Shader frag{ GL::Version::GL330, GL::Shader::Type::Fragment };
+
+    vert.addSource(rs.get("ShadowBlur.vert"));
+    if(source == Source::Depth) frag.addSource("#define DEPTH_SOURCE\n");
+    frag.addSource(rs.get("ShadowBlur.frag"));
+
+    CORRADE_INTERNAL_ASSERT_OUTPUT(GL::Shader::compile({vert, frag}));
+
+    attachShaders({vert, frag});
+
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+
+    _sourceOffsetUniform = uniformLocation("sourceOffset");
+    _sourceBoundsUniform = uniformLocation("sourceBounds");
+    _directionUniform = uniformLocation("direction");
+
+    setUniform(uniformLocation("sourceTexture"), SourceTextureLayer);
+}
+
+ShadowBlurShader& ShadowBlurShader::setSource(const Range2Di& rect, const Vector2i& targetOffset) {
+    setUniform(_sourceOffsetUniform, rect.min() - targetOffset);
+    setUniform(_sourceBoundsUniform, Vector4i{ rect.min().x(), rect.min().y(),
+                                               rect.max().x() - 1, rect.max().y() - 1 });
+    return *this;
+}
+
+ShadowBlurShader& ShadowBlurShader::setVertical(const bool vertical) {
+    setUniform(_directionUniform, vertical ? Vector2i::yAxis() : Vector2i::xAxis());
+    return *this;
+}
+
+ShadowBlurShader& ShadowBlurShader::bindSourceTexture(GL::Texture2D& texture) {
+    texture.bind(SourceTextureLayer);
+    return *this;
+}
+
+}}
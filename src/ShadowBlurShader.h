@@ -0,0 +1,61 @@
+#ifndef Magnum_Examples_Shadows_ShadowBlurShader_h
+#define Magnum_Examples_Shadows_ShadowBlurShader_h
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/Math/Range.h>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Separable Gaussian blur of shadow map moments
+ *
+ * Draws a viewport-filling triangle without any vertex buffers, so it's
+ * used with a mesh that only has its count set to 3. Each pass blurs along
+ * one axis, reading a rectangle of the source texture that's offset from
+ * the viewport.
+ */
+class ShadowBlurShader: public GL::AbstractShaderProgram {
+    public:
+        /** @brief What the source texture contains */
+        enum class Source {
+            /**
+             * Depth in the first channel, turned into moments before
+             * blurring. The texture has to have depth comparison disabled.
+             */
+            Depth,
+
+            /** Moments in the first two channels */
+            Moments
+        };
+
+        explicit ShadowBlurShader(NoCreateT): GL::AbstractShaderProgram{NoCreate} {}
+
+        explicit ShadowBlurShader(Source source);
+
+        /**
+         * @brief Set the source rectangle
+         * @param rect          Texels to read from
+         * @param targetOffset  Where in the framebuffer the first texel of
+         *      @p rect gets written to
+         *
+         * Reads outside of @p rect are clamped to its edge, so where the
+         * viewport is larger than @p rect, the edge gets repeated.
+         */
+        ShadowBlurShader& setSource(const Range2Di& rect, const Vector2i& targetOffset);
+
+        /** @brief Blur along X if @p vertical is @cpp false @ce, Y otherwise */
+        ShadowBlurShader& setVertical(bool vertical);
+
+        ShadowBlurShader& bindSourceTexture(GL::Texture2D& texture);
+
+    private:
+        enum: Int { SourceTextureLayer = 0 };
+
+        Int _sourceOffsetUniform,
+            _sourceBoundsUniform,
+            _directionUniform;
+};
+
+}}
+
+#endif
@@ -0,0 +1,4 @@
+/* Depth only, there are no color attachments to write to. Variance shadow
+   maps get their moments from the depth when it's blurred. */
+void main() {
+}
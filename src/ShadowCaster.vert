@@ -0,0 +1,10 @@
+/* The view projection matrix comes from the DrawUniforms block */
+
+in highp vec4 position;
+
+/* Per-instance */
+in highp mat4 modelMatrix;
+
+void main() {
+    gl_Position = viewProjectionMatrix * modelMatrix * position;
+}
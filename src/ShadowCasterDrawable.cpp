@@ -0,0 +1,17 @@
+#include "ShadowCasterDrawable.h"
+
+#include "Model.h"
+
+namespace Magnum { namespace Examples {
+
+ShadowCasterDrawable::ShadowCasterDrawable(SceneGraph::AbstractObject3D &object, SceneGraph::DrawableGroup3D* drawables): Drawable{object, drawables} {}
+
+void ShadowCasterDrawable::draw(const Matrix4&, SceneGraph::Camera3D&) {
+    /* Instanced through a DrawList instead */
+}
+
+Float ShadowCasterDrawable::radius() const {
+    return _model->radius;
+}
+
+}}
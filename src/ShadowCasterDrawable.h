@@ -0,0 +1,43 @@
+#ifndef Magnum_Examples_Shadows_ShadowCasterDrawable_h
+#define Magnum_Examples_Shadows_ShadowCasterDrawable_h
+
+#include <Magnum/SceneGraph/Drawable.h>
+
+namespace Magnum { namespace Examples {
+
+struct Model;
+
+/**
+ * @brief Drawable that casts shadows, rendered only into the shadow maps
+ *
+ * Not drawn on its own, culling puts the object into a @ref DrawList
+ * as an instance of its model.
+ */
+class ShadowCasterDrawable: public SceneGraph::Drawable3D {
+    public:
+        explicit ShadowCasterDrawable(SceneGraph::AbstractObject3D& object, SceneGraph::DrawableGroup3D* drawables);
+
+        void draw(const Matrix4 &transformationMatrix, SceneGraph::Camera3D& camera) override;
+
+        Model& model() { return *_model; }
+        void setModel(Model& model) { _model = &model; }
+
+        /** @brief LOD level picked for the last frame, see @ref Model::lod() */
+        UnsignedInt lod() const { return _lod; }
+        void setLod(UnsignedInt lod) { _lod = lod; }
+
+        /**
+         * @brief Bounding sphere radius of the mesh in model space
+         *
+         * Scaled by the object transformation when culling.
+         */
+        Float radius() const;
+
+    private:
+        Model* _model{};
+        UnsignedInt _lod{};
+};
+
+}}
+
+#endif
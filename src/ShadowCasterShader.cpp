@@ -0,0 +1,44 @@
+#include "ShadowCasterShader.h"
+
+#include <string>
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Version.h>
+
+#include "ProgramBinaryCache.h"
+#include "Uniforms.h"
+
+namespace Magnum { namespace Examples {
+
+ShadowCasterShader::ShadowCasterShader(ProgramBinaryCache* const binaryCache) {
+    MAGNUM_ASSERT_GL_VERSION_SUPPORTED(GL::Version::GL330);
+
+    const Utility::Resource rs{"shadow-data"};
+
+    GL::Shader vert{ GL::Version::GL330, GL::Shader::Type::Vertex };
+    GL::Shader frag{ GL::Version::GL330, GL::Shader::Type::Fragment };
+
+    vert.addSource("#define MAX_SHADOW_MAP_LEVELS " + std::to_string(MaxShadowMapLevels) + "\n");
+    vert.addSource(rs.get("Uniforms.glsl"));
+    vert.addSource(rs.get("ShadowCaster.vert"));
+    frag.addSource(rs.get("ShadowCaster.frag"));
+
+    if(!binaryCache || !binaryCache->load(*this, {vert, frag})) {
+        CORRADE_INTERNAL_ASSERT_OUTPUT(GL::Shader::compile({vert, frag}));
+
+        bindAttributeLocation(Position::Location, "position");
+        bindAttributeLocation(TransformationMatrix::Location, "modelMatrix");
+
+        attachShaders({vert, frag});
+
+        if(binaryCache) binaryCache->prepare(*this);
+        CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+        if(binaryCache) binaryCache->save(*this, {vert, frag});
+    }
+
+    setUniformBlockBinding(uniformBlockIndex("DrawUniforms"), DrawUniformBinding);
+}
+
+}}
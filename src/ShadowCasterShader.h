@@ -0,0 +1,38 @@
+#ifndef Magnum_Examples_Shadows_ShadowCasterShader_h
+#define Magnum_Examples_Shadows_ShadowCasterShader_h
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/Shaders/Generic.h>
+
+namespace Magnum { namespace Examples {
+
+class ProgramBinaryCache;
+
+/**
+ * @brief Shader used to render shadow casters into shadow maps
+ *
+ * Depth-only in both shadow modes, @ref ShadowMode::Variance derives the
+ * moments from the depth afterwards. The light's view projection matrix is
+ * read from a @ref DrawUniforms block bound at @ref DrawUniformBinding.
+ */
+class ShadowCasterShader: public GL::AbstractShaderProgram {
+    public:
+        typedef Shaders::Generic3D::Position Position;
+
+        /** @brief Per-instance model matrix */
+        typedef Shaders::Generic3D::TransformationMatrix TransformationMatrix;
+
+        explicit ShadowCasterShader(NoCreateT): GL::AbstractShaderProgram{NoCreate} {}
+
+        /**
+         * @brief Constructor
+         *
+         * The linked program is taken from @p binaryCache if it's there
+         * and stored to it otherwise, unless it's @cpp nullptr @ce.
+         */
+        explicit ShadowCasterShader(ProgramBinaryCache* binaryCache = nullptr);
+};
+
+}}
+
+#endif
@@ -1,16 +1,27 @@
 #include "ShadowLight.h"
 
 #include <algorithm>  // std::any_of
+#include <cmath>
+#include <functional>
+#include <Corrade/Containers/ArrayViewStl.h>
 #include <Magnum/ImageView.h>
 #include <Magnum/Image.h>
-#include <Magnum/GL/DefaultFramebuffer.h>
 #include <Magnum/GL/PixelFormat.h>
 #include <Magnum/GL/Renderer.h>
 #include <Magnum/GL/TextureFormat.h>
+#include <Magnum/Math/Functions.h>
 #include <Magnum/SceneGraph/FeatureGroup.h>
 #include <Magnum/SceneGraph/MatrixTransformation3D.h>
 #include <Magnum/SceneGraph/Scene.h>
 
+#include "GpuCulling.h"
+#include "Model.h"
+#include "ShadowCasterDrawable.h"
+#include "ShadowCasterShader.h"
+#include "ShadowMath.h"
+#include "UniformRing.h"
+#include "Uniforms.h"
+
 namespace Magnum { namespace Examples {
 
 ShadowLight::ShadowLight(SceneGraph::Object<SceneGraph::MatrixTransformation3D>& parent)
@@ -19,40 +30,91 @@ ShadowLight::ShadowLight(SceneGraph::Object<SceneGraph::MatrixTransformation3D>&
     setAspectRatioPolicy(SceneGraph::AspectRatioPolicy::NotPreserved);
 }
 
-void ShadowLight::setupShadowmaps(const Vector2i& size) {
-    _shadowTexture = GL::Texture2D{};
-    _shadowTexture
+ShadowLight::~ShadowLight() {
+    releaseShadowmaps();
+}
+
+void ShadowLight::releaseShadowmaps() {
+    if(_atlas) {
+        for(const ShadowLayerData& layer: _layers) {
+            _atlas->release(layer.tile);
+        }
+    }
+
+    _layers.clear();
+    _culled.clear();
+    _layerMatrices.clear();
+    _layerRects.clear();
+    _mainProjection = Matrix4{ Math::ZeroInit };
+    _staticAtlas = ShadowAtlas{NoCreate};
+}
+
+Int ShadowLight::layerTileSize(const Int layer, const Int size) {
+    return ShadowAtlas::tileSize(1.0f/Float(1 << Math::min(layer, 2)), size);
+}
+
+bool ShadowLight::setupShadowmaps(ShadowAtlas& atlas,
+                                  const Int numShadowLevels,
+                                  const Int size) {
+    releaseShadowmaps();
+    _atlas = &atlas;
 
-        // Needs to be DepthComponent24 - not 8, 16 or 32 - unsure why
-        .setStorage(1, GL::TextureFormat::DepthComponent24, size)
-        
-        // Required, else OpenGL will tell you..
-        //    Program undefined behavior warning: 
-        //    Sampler object 0 does not have depth compare enabled.
-        //    It is being used with depth texture 2, by a program
-        //    that samples it with a shadow sampler.
-        //    This is undefined behavior.
-        .setCompareFunction(GL::SamplerCompareFunction::LessOrEqual)
-        .setCompareMode(GL::SamplerCompareMode::CompareRefToTexture)
-    ;
+    _layers.reserve(numShadowLevels);
+    for(Int i = 0; i != numShadowLevels; ++i) {
+        Containers::Optional<Range2Di> tile = atlas.allocate(layerTileSize(i, size));
+        if(!tile) {
+            releaseShadowmaps();
+            return false;
+        }
 
-    _data = new ShadowData{size};
+        _layers.emplace_back(*tile);
+        _layerRects.push_back(atlas.uvRect(*tile));
+    }
+    _layerMatrices.resize(_layers.size());
+    _culled.resize(2*_layers.size());
+
+    if(_cachingEnabled) {
+        setupStaticCache();
+    }
 
-    GL::Framebuffer& shadowFramebuffer = _data->shadowFramebuffer;
-    shadowFramebuffer.attachTexture(GL::Framebuffer::BufferAttachment::Depth,
-                                    _shadowTexture, 0)
-                     .mapForDraw(GL::Framebuffer::DrawAttachment::None)
-                     .bind();
+    if(_mode == ShadowMode::Variance) {
+        setupBlur();
+    }
 
-    CORRADE_INTERNAL_ASSERT(
-        shadowFramebuffer.checkStatus(GL::FramebufferTarget::Draw) ==
-        GL::Framebuffer::Status::Complete
-    );
+    return true;
 }
 
-ShadowLight::ShadowData::ShadowData(const Vector2i& size) 
-    : shadowFramebuffer{ { {}, size } } {}
+ShadowLight::ShadowLayerData::ShadowLayerData(const Range2Di& atlasTile)
+    : tile{atlasTile} {}
+
+void ShadowLight::setupSplitDistances(const Float zNear,
+                                      const Float zFar,
+                                      const Float lambda) {
+    /* The "practical split scheme", a blend of logarithmic and uniform
+       distribution, see GPU Gems 3, chapter 10 */
+    const Float count = Float(_layers.size());
+    for(std::size_t i = 0; i != _layers.size(); ++i) {
+        const Float fraction = Float(i + 1) / count;
+        const Float logarithmic = zNear * std::pow(zFar / zNear, fraction);
+        const Float uniform = zNear + (zFar - zNear) * fraction;
+        const Float linearDepth = Math::lerp(uniform, logarithmic, lambda);
+
+        /* Convert to NDC depth of the main camera, which is what
+           frustumCorners() operates on */
+        _layers[i].cutPlane = (zFar + zNear - 2.0f * zNear * zFar / linearDepth)
+                            / (zFar - zNear);
+    }
+
+    /* The layer radii depend on the cuts */
+    _mainProjection = Matrix4{ Math::ZeroInit };
+}
 
+Float ShadowLight::cutDistance(const Float zNear,
+                               const Float zFar,
+                               const Int layer) const {
+    const Float depthSample = _layers[layer].cutPlane;
+    return 2.0f * zNear * zFar / (zFar + zNear - depthSample * (zFar - zNear));
+}
 
 void ShadowLight::setTarget(const Vector3& lightDirection,
                             const Vector3& screenDirection,
@@ -61,65 +123,336 @@ void ShadowLight::setTarget(const Vector3& lightDirection,
     const Matrix3x3 cameraRotationMatrix = cameraMatrix.rotation();
     const Matrix3x3 inverseCameraRotationMatrix = cameraRotationMatrix.inverted();
 
-    std::size_t dataIndex { 0 };
+    /* Only the orientation matters to users of the object, the position
+       differs for each layer and is applied in render() */
+    _object.setTransformation(cameraMatrix);
+
+    /* A still camera doesn't need the inversion again */
+    const Matrix4 viewProjection = mainCamera.projectionMatrix()*Examples::cameraMatrix(mainCamera);
+    if(viewProjection != _mainViewProjection) {
+        _mainViewProjection = viewProjection;
+        _inverseMainViewProjection = viewProjection.inverted();
+    }
+
+    if(_layers.empty()) return;
 
-    std::vector<Vector3> mainCameraFrustumCorners = frustumCorners(
-        mainCamera, Int(dataIndex)
-    );
+    /* The radii are measured in camera space, where the slices don't move.
+       Measured in world space, rounding would make them differ a tiny bit
+       every frame, and with them the shadow matrices. */
+    if(mainCamera.projectionMatrix() != _mainProjection) {
+        _mainProjection = mainCamera.projectionMatrix();
+        const Matrix4 inverseProjection = _mainProjection.inverted();
+        for(std::size_t layerIndex = 0; layerIndex != _layers.size(); ++layerIndex) {
+            const FrustumCorners corners = frustumCorners(inverseProjection,
+                layerIndex == 0 ? -1.0f : _layers[layerIndex - 1].cutPlane,
+                _layers[layerIndex].cutPlane);
 
-    /* Calculate the AABB in shadow-camera space */
-    Vector3 min { std::numeric_limits<Float>::max() };
-    Vector3 max { std::numeric_limits<Float>::lowest() };
+            Vector3 center;
+            for(const Vector3& corner: corners) center += corner;
+            center /= Float(corners.size());
 
-    for (Vector3 worldPoint: mainCameraFrustumCorners) {
-        Vector3 cameraPoint = inverseCameraRotationMatrix * worldPoint;
-        min = Math::min(min, cameraPoint);
-        max = Math::max(max, cameraPoint);
+            Float radius = 0.0f;
+            for(const Vector3& corner: corners) {
+                radius = Math::max(radius, (corner - center).length());
+            }
+            _layers[layerIndex].radius = radius;
+        }
     }
 
-    /* Place the shadow camera at the mid-point of the camera box */
-    const Vector3 mid = (min + max) * 0.5f;
-    const Vector3 cameraPosition = cameraRotationMatrix * mid;
-    const Vector3 range = max - min;
+    for(std::size_t layerIndex = 0; layerIndex != _layers.size(); ++layerIndex) {
+        ShadowLayerData& layer = _layers[layerIndex];
+        const FrustumCorners mainCameraFrustumCorners = frustumCorners(
+            _inverseMainViewProjection,
+            layerIndex == 0 ? -1.0f : _layers[layerIndex - 1].cutPlane,
+            layer.cutPlane
+        );
+
+        /* Center of the slice in shadow-camera space */
+        Vector3 center;
+        for(const Vector3& corner: mainCameraFrustumCorners) center += corner;
+        center = inverseCameraRotationMatrix*(center/Float(mainCameraFrustumCorners.size()));
+
+        /* Snap the center to the texel grid, so whatever's in the shadow map
+           only ever shifts by whole texels, and along the light direction
+           to the radius, which the depth range below makes room for */
+        const Float radius = layer.radius;
+        const Float texelSize = 2.0f*radius/Float(viewportSize(Int(layerIndex)));
+        const Vector3 snapped{ Math::floor(center.x()/texelSize)*texelSize,
+                               Math::floor(center.y()/texelSize)*texelSize,
+                               Math::ceil(center.z()/radius)*radius };
 
-    /* Set up the initial extends of the shadow map's render volume. Note
-       we will adjust this later when we render. */
-    _data->orthographicSize = range.xy();
-    _data->orthographicNear = -0.5f * range.z();
-    _data->orthographicFar =  0.5f * range.z();
-    cameraMatrix.translation() = cameraPosition;
-    _data->shadowCameraMatrix = cameraMatrix;
+        /* The camera is at most a radius behind the sphere center, so the
+           sphere is within -r and 2r of it. Note we will adjust the near
+           plane later when we render. */
+        layer.orthographicSize = Vector2{ 2.0f*radius };
+        layer.orthographicNear = -radius;
+        layer.orthographicFar = 2.0f*radius;
+        cameraMatrix.translation() = cameraRotationMatrix*snapped;
+        layer.shadowCameraMatrix = cameraMatrix;
+        layer.layerCameraMatrix = cameraMatrix.invertedRigid();
+    }
 }
 
-std::vector<Vector3> ShadowLight::frustumCorners(SceneGraph::Camera3D& mainCamera,
-                                                 const Int data) {
-    const Float z0 = data == 0 ? 0 : _data->cutPlane;
-    const Float z1 = _data->cutPlane;
+ShadowLight::FrustumCorners ShadowLight::frustumCorners(SceneGraph::Camera3D& mainCamera,
+                                                        const Int layer) {
+    const Float z0 = layer == 0 ? -1.0f : _layers[layer - 1].cutPlane;
+    const Float z1 = _layers[layer].cutPlane;
     return frustumCorners(mainCamera, z0, z1);
 }
 
-std::vector<Vector3> ShadowLight::frustumCorners(SceneGraph::Camera3D& mainCamera,
-                                                 const Float z0,
-                                                 const Float z1) {
-    const Matrix4 imvp = (mainCamera.projectionMatrix()*mainCamera.cameraMatrix()).inverted();
+ShadowLight::FrustumCorners ShadowLight::frustumCorners(SceneGraph::Camera3D& mainCamera,
+                                                        const Float z0,
+                                                        const Float z1) {
+    const Matrix4 imvp = (mainCamera.projectionMatrix()*Examples::cameraMatrix(mainCamera)).inverted();
     return frustumCorners(imvp, z0, z1);
 }
 
-std::vector<Vector3> ShadowLight::frustumCorners(const Matrix4& imvp,
-                                                 const Float z0,
-                                                 const Float z1) {
-    return { imvp.transformPoint({-1,-1, z0}),
-             imvp.transformPoint({ 1,-1, z0}),
-             imvp.transformPoint({-1, 1, z0}),
-             imvp.transformPoint({ 1, 1, z0}),
-             imvp.transformPoint({-1,-1, z1}),
-             imvp.transformPoint({ 1,-1, z1}),
-             imvp.transformPoint({-1, 1, z1}),
-             imvp.transformPoint({ 1, 1, z1}) };
+ShadowLight::FrustumCorners ShadowLight::frustumCorners(const Matrix4& imvp,
+                                                        const Float z0,
+                                                        const Float z1) {
+    return Examples::frustumCorners(imvp, z0, z1);
+}
+
+void ShadowLight::setResolutionScale(const Float scale) {
+    CORRADE_INTERNAL_ASSERT(scale > 0.0f && scale <= 1.0f);
+    _resolutionScale = scale;
+}
+
+Int ShadowLight::viewportSize(const Int layer) const {
+    /* Rounded so small changes of the scale don't invalidate the cache */
+    const Int size = _layers[layer].tile.sizeX();
+    return Math::min((Int(Float(size)*_resolutionScale) + 7)/8*8, size);
+}
+
+void ShadowLight::setCachingEnabled(const bool enabled) {
+    _cachingEnabled = enabled;
+    for(ShadowLayerData& layer: _layers) {
+        layer.staticCacheValid = false;
+    }
+
+    if(_cachingEnabled && !_layers.empty() && !_staticAtlas.texture().id()) {
+        setupStaticCache();
+    }
+}
+
+void ShadowLight::setShadowMode(const ShadowMode mode) {
+    _mode = mode;
+
+    /* Moments of the layers that keep their cached depth would be missing
+       after a switch to variance shadows */
+    for(ShadowLayerData& layer: _layers) {
+        layer.staticCacheValid = false;
+    }
+
+    if(_mode == ShadowMode::Variance) {
+        if(!_layers.empty()) setupBlur();
+    } else {
+        if(_atlas) _atlas->setCompareEnabled(true);
+        _blurTexture = GL::Texture2D{NoCreate};
+        _blurFramebuffer = GL::Framebuffer{NoCreate};
+        _momentsTexture = GL::Texture2DArray{NoCreate};
+        _momentsFramebuffers.clear();
+    }
+}
+
+void ShadowLight::setupBlur() {
+    /* The blur reads the depth values themselves */
+    _atlas->setCompareEnabled(false);
+
+    if(!_depthBlurShader.id()) {
+        _depthBlurShader = ShadowBlurShader{ ShadowBlurShader::Source::Depth };
+        _momentsBlurShader = ShadowBlurShader{ ShadowBlurShader::Source::Moments };
+        _blurMesh = GL::Mesh{};
+        _blurMesh.setCount(3);
+    }
+
+    /* Holds one layer between the horizontal and the vertical pass, the
+       first one is the largest */
+    const Vector2i size{ this->size() };
+    _blurTexture = GL::Texture2D{};
+    _blurTexture.setStorage(1, GL::TextureFormat::RG32F, size);
+
+    _blurFramebuffer = GL::Framebuffer{ { {}, size } };
+    _blurFramebuffer.attachTexture(GL::Framebuffer::ColorAttachment{ 0 },
+                                   _blurTexture, 0);
+
+    /* Each cascade gets a whole layer with a full mip chain. Mipmapping
+       works on each layer separately, so cascades never get mixed. */
+    const Int levels = Math::log2(UnsignedInt(size.x())) + 1;
+    _momentsTexture = GL::Texture2DArray{};
+    _momentsTexture
+        .setStorage(levels, GL::TextureFormat::RG32F, { size, Int(_layers.size()) })
+        .setMinificationFilter(GL::SamplerFilter::Linear, GL::SamplerMipmap::Linear)
+        .setMagnificationFilter(GL::SamplerFilter::Linear)
+        .setWrapping(GL::SamplerWrapping::ClampToEdge);
+
+    _momentsFramebuffers.clear();
+    _momentsFramebuffers.reserve(_layers.size());
+    for(std::size_t i = 0; i != _layers.size(); ++i) {
+        _momentsFramebuffers.emplace_back(Range2Di{ {}, size });
+        _momentsFramebuffers.back().attachTextureLayer(
+            GL::Framebuffer::ColorAttachment{ 0 }, _momentsTexture, 0, Int(i));
+    }
+}
+
+std::size_t ShadowLight::momentsMemoryUsage() const {
+    if(!_momentsTexture.id()) return 0;
+    const std::size_t texels = std::size_t(size())*std::size_t(size())*_layers.size();
+    return texels*8*4/3;
+}
+
+void ShadowLight::blurLayer(const Int layer, const Range2Di& viewport) {
+    GL::Renderer::disable(GL::Renderer::Feature::DepthTest);
+    GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
+
+    /* Horizontally from the atlas depth into the scratch texture, turning
+       it into moments on the way.. */
+    _blurFramebuffer.setViewport({ {}, viewport.size() })
+                    .bind();
+    _depthBlurShader.setSource(viewport, {})
+                    .setVertical(false)
+                    .bindSourceTexture(_atlas->texture())
+                    .draw(_blurMesh);
+
+    /* ..and vertically into the layer. All of it is written, past the
+       rendered part the edge repeats, so the mip chain doesn't pick up
+       what was there at a different resolution scale. */
+    _momentsFramebuffers[layer].bind();
+    _momentsBlurShader.setSource({ {}, viewport.size() }, {})
+                      .setVertical(true)
+                      .bindSourceTexture(_blurTexture)
+                      .draw(_blurMesh);
+
+    GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+    GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
+}
+
+void ShadowLight::setupStaticCache() {
+    /* A private atlas just big enough for a copy of every layer */
+    std::vector<Int> tileSizes;
+    tileSizes.reserve(_layers.size());
+    for(const ShadowLayerData& layer: _layers) {
+        tileSizes.push_back(layer.tile.sizeX());
+    }
+    _staticAtlas = ShadowAtlas{ ShadowAtlas::fittingSize(tileSizes) };
+
+    for(ShadowLayerData& layer: _layers) {
+        layer.staticTile = *_staticAtlas.allocate(layer.tile.sizeX());
+        layer.staticCacheValid = false;
+    }
+}
+
+void ShadowLight::prepare(SpatialIndex& staticCasters,
+                          SpatialIndex& dynamicCasters,
+                          ThreadPool& pool) {
+    /* A static caster that moved since the last frame invalidates the cached
+       depth of all layers. Setting a transformation marks the object dirty,
+       cleaning it here arms the check for the next frame. Dynamic casters
+       are expected to move all the time, so they're left dirty. */
+    _staticCastersDirty = staticCasters.refit(true, pool) != 0;
+    dynamicCasters.refit(false, pool);
+
+    _staticCasters = &staticCasters;
+    _dynamicCasters = &dynamicCasters;
+    _gpuCulling = nullptr;
+}
+
+/* Clip casters by the sides and the far end of the volume. Anything
+   between the volume and the light can still throw a shadow into it, so
+   instead of culling those, the near plane is left open and pulled
+   towards the light to include them. */
+Frustum ShadowLight::casterVolume(const ShadowLayerData& layer) {
+    const Frustum volume = Frustum::fromMatrix(
+        Matrix4::orthographicProjection(layer.orthographicSize,
+                                        layer.orthographicNear,
+                                        layer.orthographicFar)*layer.layerCameraMatrix);
+    return { volume.left(), volume.right(),
+             volume.bottom(), volume.top(),
+             { 0.0f, 0.0f, 0.0f, 1.0f }, volume.far() };
+}
+
+void ShadowLight::cull(const std::size_t task,
+                       const Containers::ArrayView<const Model> models) {
+    const ShadowLayerData& layer = _layers[task/2];
+    const SpatialIndex& casters = task % 2 ? *_dynamicCasters : *_staticCasters;
+    CullResult& result = _culled[task];
+
+    casters.query(casterVolume(layer), Matrix4{}, result.visible);
+
+    /* Depth-only rendering gains little from it, but it's cheap here and
+       makes the draw order stable from frame to frame */
+    sortFrontToBack(result.visible, layer.layerCameraMatrix);
+
+    result.orthographicNear = layer.orthographicNear;
+    result.drawList.reset(models);
+    for(const DrawableTransformations::value_type& caster: result.visible) {
+        auto& drawable = static_cast<ShadowCasterDrawable&>(caster.first.get());
+        const Matrix4& transformation = caster.second;
+        const Float radius = transformation.scaling().max()*drawable.radius();
+        const Float depth = -layer.layerCameraMatrix.transformPoint(transformation.translation()).z();
+        result.orthographicNear = Math::min(result.orthographicNear, depth - radius);
+        result.drawList.add(drawable.model().lod(models, drawable.lod()), transformation, depth);
+    }
+
+    /* Rounded down, so the near plane moves, and the static depth gets
+       rendered again, only when a caster crosses a whole radius */
+    result.orthographicNear = Math::floor(result.orthographicNear/layer.radius)*layer.radius;
+
+    result.hasCasters = !result.visible.empty();
+    result.culledCount = casters.size() - result.visible.size();
+}
+
+void ShadowLight::cull(GpuCulling& culling) {
+    _gpuCulling = &culling;
+
+    for(std::size_t task = 0; task != _culled.size(); ++task) {
+        const ShadowLayerData& layer = _layers[task/2];
+        const SpatialIndex& casters = task % 2 ? *_dynamicCasters : *_staticCasters;
+        CullResult& result = _culled[task];
+
+        culling.cull(UnsignedInt(task), casterVolume(layer));
+
+        /* What's visible isn't known here, so the near plane is pulled in
+           front of everything in the index instead */
+        result.orthographicNear = layer.orthographicNear;
+        const Range3D bounds = casters.bounds();
+        for(std::size_t i = 0; i != 8; ++i) {
+            const Vector3 corner{ (i & 1 ? bounds.max() : bounds.min()).x(),
+                                  (i & 2 ? bounds.max() : bounds.min()).y(),
+                                  (i & 4 ? bounds.max() : bounds.min()).z() };
+            result.orthographicNear = Math::min(result.orthographicNear,
+                -layer.layerCameraMatrix.transformPoint(corner).z());
+        }
+
+        result.hasCasters = casters.size() != 0;
+        result.culledCount = 0;
+    }
 }
 
+void ShadowLight::drawCasters(const std::initializer_list<std::size_t> tasks,
+                              const Matrix4& viewProjectionMatrix,
+                              ShadowCasterShader& shader,
+                              UniformRing& uniforms,
+                              const Containers::ArrayView<Model> models) {
+    uniforms.bind(DrawUniformBinding, DrawUniforms{ viewProjectionMatrix });
+
+    if(_gpuCulling) {
+        for(const std::size_t task: tasks) {
+            _gpuCulling->draw(UnsignedInt(task), shader, _statistics);
+        }
+        return;
+    }
+
+    for(const std::size_t task: tasks) {
+        _culled[task].drawList.enqueue(_queue, shader, models);
+        _drawnCount += _culled[task].drawList.size();
+    }
+    _queue.submit(_statistics);
+}
 
-void ShadowLight::render(SceneGraph::DrawableGroup3D& drawables) {
+void ShadowLight::render(ShadowCasterShader& shader,
+                         UniformRing& uniforms,
+                         const Containers::ArrayView<Model> models) {
     /* Projecting world points normalized device coordinates means they range
        -1 -> 1. Use this bias matrix so we go straight from world -> texture
        space */
@@ -130,30 +463,119 @@ void ShadowLight::render(SceneGraph::DrawableGroup3D& drawables) {
 
     GL::Renderer::setDepthMask(true);
 
-    Float orthographicNear = _data->orthographicNear;
-    const Float orthographicFar = _data->orthographicFar;
+    _drawnCount = 0;
+    _culledCount = 0;
+    _cachedLayerCount = 0;
+    _statistics = {};
+
+    /* Casters write only depth in both modes, so the cache works for both
+       as well */
+    const bool caching = _cachingEnabled;
+    bool momentsChanged = false;
+
+    for(std::size_t layerIndex = 0; layerIndex != _layers.size(); ++layerIndex) {
+        ShadowLayerData& layer = _layers[layerIndex];
+        const Vector2i viewportSize{ this->viewportSize(Int(layerIndex)) };
+        const Range2Di viewport = Range2Di::fromSize(layer.tile.min(), viewportSize);
+        const CullResult& staticCasters = _culled[2*layerIndex];
+        const CullResult& dynamicCasters = _culled[2*layerIndex + 1];
+        _culledCount += staticCasters.culledCount + dynamicCasters.culledCount;
+
+        /* With caching, the volume is fitted only to the static casters so
+           it stays the same from frame to frame. Dynamic casters in front
+           of it get flattened onto the near plane by depth clamping. */
+        const Float orthographicNear = caching ? staticCasters.orthographicNear :
+            Math::min(staticCasters.orthographicNear, dynamicCasters.orthographicNear);
+
+        setProjectionMatrix(
+            Matrix4::orthographicProjection(
+                layer.orthographicSize,
+                orthographicNear,
+                layer.orthographicFar
+            )
+        );
 
-    /* Move this whole object to the right place */
-    _object.setTransformation(_data->shadowCameraMatrix)
-           .setClean();
+        const Matrix4 viewProjectionMatrix = projectionMatrix()*layer.layerCameraMatrix;
+        /* Mapping to the viewport instead of the whole tile also changes
+           the matrix whenever the resolution scale does, which the cache
+           check below relies on. Variance receivers sample the layer's
+           moments instead, where the viewport is in the bottom left
+           corner and the edge repeats past it, so there's nothing to
+           bleed into. */
+        if(_mode == ShadowMode::Variance) {
+            const Vector2 fraction = Vector2{ viewportSize } / Float(size());
+            layer.shadowMatrix = Matrix4::scaling({ fraction, 1.0f })
+                               * bias
+                               * viewProjectionMatrix;
+            _layerRects[layerIndex] = { 0.0f, 0.0f, fraction.x(), fraction.y() };
+        } else {
+            layer.shadowMatrix = _atlas->tileMatrix(viewport)
+                               * bias
+                               * viewProjectionMatrix;
+            _layerRects[layerIndex] = _atlas->uvRect(viewport);
+        }
+        _layerMatrices[layerIndex] = layer.shadowMatrix;
 
-    setProjectionMatrix(
-        Matrix4::orthographicProjection(
-            _data->orthographicSize,
-            orthographicNear,
-            orthographicFar
-        )
-    );
+        if(!caching) {
+            /* Same-model static and dynamic casters end up next to each
+               other */
+            _atlas->bindTile(viewport, true);
+            drawCasters({ 2*layerIndex, 2*layerIndex + 1 },
+                        viewProjectionMatrix, shader, uniforms, models);
+            if(_mode == ShadowMode::Variance) {
+                blurLayer(Int(layerIndex), viewport);
+                momentsChanged = true;
+            }
+            continue;
+        }
 
-    _data->shadowMatrix = bias
-                        * projectionMatrix()
-                        * cameraMatrix();
-    _data->shadowFramebuffer.clear(GL::FramebufferClear::Depth)
-                            .bind();
+        const bool cacheValid = layer.staticCacheValid &&
+                                !_staticCastersDirty &&
+                                layer.cachedShadowMatrix == layer.shadowMatrix;
+        const bool hasDynamicCasters = dynamicCasters.hasCasters;
 
-    this->draw(drawables);
+        /* Nothing changed, the layer still contains exactly the static depth
+           from the last frame, and the moments made from it */
+        if(cacheValid && !hasDynamicCasters && !layer.hasDynamicCasters) {
+            ++_cachedLayerCount;
+            continue;
+        }
+
+        const Range2Di staticViewport = Range2Di::fromSize(layer.staticTile.min(), viewportSize);
+        if(cacheValid) {
+            ++_cachedLayerCount;
+        } else {
+            _staticAtlas.bindTile(staticViewport, true);
+            drawCasters({ 2*layerIndex }, viewProjectionMatrix, shader, uniforms, models);
+            layer.cachedShadowMatrix = layer.shadowMatrix;
+            layer.staticCacheValid = true;
+        }
+
+        GL::AbstractFramebuffer::blit(
+            _staticAtlas.framebuffer(),
+            _atlas->framebuffer(),
+            staticViewport,
+            viewport,
+            GL::FramebufferBlit::Depth,
+            GL::FramebufferBlitFilter::Nearest
+        );
+
+        if(hasDynamicCasters) {
+            _atlas->bindTile(viewport, false);
+            GL::Renderer::enable(GL::Renderer::Feature::DepthClamp);
+            drawCasters({ 2*layerIndex + 1 }, viewProjectionMatrix, shader, uniforms, models);
+            GL::Renderer::disable(GL::Renderer::Feature::DepthClamp);
+        }
+
+        layer.hasDynamicCasters = hasDynamicCasters;
+
+        if(_mode == ShadowMode::Variance) {
+            blurLayer(Int(layerIndex), viewport);
+            momentsChanged = true;
+        }
+    }
 
-    GL::defaultFramebuffer.bind();
+    if(momentsChanged) _momentsTexture.generateMipmap();
 }
 
 }}
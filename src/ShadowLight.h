@@ -1,17 +1,36 @@
 #ifndef Magnum_Examples_Shadows_ShadowLight_h
 #define Magnum_Examples_Shadows_ShadowLight_h
 
+#include <array>
+#include <initializer_list>
+#include <vector>
+#include <Corrade/Containers/ArrayView.h>
 #include <Magnum/Resource.h>
 #include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Mesh.h>
 #include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureArray.h>
+#include <Magnum/Math/Range.h>
 #include <Magnum/SceneGraph/Camera.h>
 #include <Magnum/SceneGraph/Drawable.h>
 #include <Magnum/SceneGraph/AbstractFeature.h>
 
+#include "DrawList.h"
+#include "Model.h"
+#include "RenderQueue.h"
+#include "ShadowAtlas.h"
+#include "ShadowBlurShader.h"
+#include "ShadowMath.h"
+#include "SpatialIndex.h"
 #include "Types.h"
 
 namespace Magnum { namespace Examples {
 
+class GpuCulling;
+class ShadowCasterShader;
+class ThreadPool;
+class UniformRing;
+
 /**
  * @brief A special camera used to render shadow maps
  *
@@ -20,19 +39,61 @@ namespace Magnum { namespace Examples {
  */
 class ShadowLight: public SceneGraph::Camera3D {
     public:
-        static std::vector<Vector3> frustumCorners(SceneGraph::Camera3D& mainCamera, Float z0 = -1.0f, Float z1 = 1.0f);
-        static std::vector<Vector3> frustumCorners(const Matrix4& imvp, Float z0, Float z1);
-        std::vector<Vector3> frustumCorners(SceneGraph::Camera3D& mainCamera, Int layer);
+        typedef Examples::FrustumCorners FrustumCorners;
+
+        static FrustumCorners frustumCorners(SceneGraph::Camera3D& mainCamera, Float z0 = -1.0f, Float z1 = 1.0f);
+        static FrustumCorners frustumCorners(const Matrix4& imvp, Float z0, Float z1);
+        FrustumCorners frustumCorners(SceneGraph::Camera3D& mainCamera, Int layer);
 
         explicit ShadowLight(SceneGraph::Object<SceneGraph::MatrixTransformation3D>& parent);
 
+        /** @brief Destructor, gives the tiles back to the atlas */
+        ~ShadowLight();
+
+        /**
+         * @brief Tile size of given cascade
+         *
+         * The nearest cascade gets @p size, each further one half of the
+         * one before, but no less than a quarter of @p size. Shadows close
+         * to the camera cover most of the screen and are looked at the
+         * most, the far ones are spread over a few pixels of the horizon.
+         * Rounded to a power of two by @ref ShadowAtlas::tileSize().
+         */
+        static Int layerTileSize(Int layer, Int size);
+
         /**
-         * @brief Initialize the shadow map texture array and framebuffers
+         * @brief Allocate the shadow maps in an atlas
          *
+         * Allocates one square tile of @ref layerTileSize() per cascade,
+         * largest first, releasing the previously allocated ones. The atlas
+         * has to outlive the light. Returns @cpp false @ce and leaves the
+         * light without any layers if there isn't enough free space.
          * Should be called before @ref setupSplitDistances().
+         */
+        bool setupShadowmaps(ShadowAtlas& atlas, Int numShadowLevels, Int size);
+
+        /**
+         * @brief Give the tiles back to the atlas
+         *
+         * Leaves the light without any layers. Has to be called before the
+         * atlas is destroyed or replaced while the light still has tiles in
+         * it.
+         */
+        void releaseShadowmaps();
+
+        /**
+         * @brief Set up the distances at which the camera frustum is split
+         * @param zNear     Near plane of the main camera
+         * @param zFar      Far plane of the main camera
+         * @param lambda    Blend between uniform (@cpp 0.0f @ce) and
+         *      logarithmic (@cpp 1.0f @ce) split distribution
          *
+         * Logarithmic splits give the cascades near the camera most of the
+         * resolution, uniform splits spread it evenly over the view distance.
+         * Should be called whenever the number of levels or the main camera's
+         * projection changes.
          */
-        void setupShadowmaps(const Vector2i& size);
+        void setupSplitDistances(Float zNear, Float zFar, Float lambda);
 
         /**
          * @brief Computes all the matrices for the shadow map splits
@@ -45,40 +106,291 @@ class ShadowLight: public SceneGraph::Camera3D {
          *      splits (normally, the main camera that the shadows will be
          *      rendered to)
          *
+         * Each layer covers the bounding sphere of its slice of the camera
+         * frustum, with the center snapped to whole texels of the rendered
+         * part of the tile across and to the sphere radius along the light.
+         * Moving the camera then shifts the shadow map by whole texels only,
+         * and a move within a texel leaves the shadow matrix and with it
+         * the cached static depth as it was. The @p screenDirection has to
+         * stay constant for that.
+         *
          * Should be called whenever your camera moves.
          */
         void setTarget(const Vector3& lightDirection, const Vector3& screenDirection, SceneGraph::Camera3D& mainCamera);
 
         /**
-         * @brief Render a group of shadow-casting drawables to the shadow maps
+         * @brief Update the caster indices for this frame
+         *
+         * Expects the indices to contain only @ref ShadowCasterDrawable
+         * instances. Both get refitted on @p pool, with the static caster
+         * objects cleaned so their next move is noticed. The indices have
+         * to stay alive until @ref render(). Call after @ref setTarget().
+         */
+        void prepare(SpatialIndex& staticCasters, SpatialIndex& dynamicCasters, ThreadPool& pool);
+
+        /** @brief Whether a static caster moved before the last @ref prepare() */
+        bool staticCastersMoved() const { return _staticCastersDirty; }
+
+        /** @brief Number of @ref cull() tasks, one per layer and index */
+        std::size_t cullTaskCount() const { return _culled.size(); }
+
+        /**
+         * @brief Cull casters of one layer and build its draw list
+         *
+         * Queries either the static or the dynamic casters with the layer
+         * volume and groups the ones found by their @p models. Doesn't touch
+         * GL or the scene graph, so different tasks can run concurrently on
+         * worker threads after @ref prepare() returned.
+         */
+        void cull(std::size_t task, Containers::ArrayView<const Model> models);
+
+        /**
+         * @brief Cull casters of all layers on the GPU
+         *
+         * Alternative to the @ref cull() tasks. View @cpp i @ce of
+         * @p culling gets the volume of what would be task @cpp i @ce,
+         * culling the static casters of layer @cpp i/2 @ce for even views
+         * and the dynamic ones for odd views. As the visible casters aren't
+         * known on the CPU, the near plane of each layer is fitted to the
+         * bounds of the whole index. Call after @ref prepare().
+         */
+        void cull(GpuCulling& culling);
+
+        /**
+         * @brief Render the culled casters to the shadow maps
+         *
+         * Draws the lists built by @ref cull() instanced with @p shader, one
+         * draw call per model, layer and index, or a single indirect draw
+         * per layer and index after the GPU @ref cull(). Within a layer the draws
+         * are sorted to bind each mesh once. The view projection matrix of
+         * each pass is streamed through @p uniforms. Leaves the atlas
+         * framebuffer bound.
+         *
+         * With @ref setCachingEnabled() the depth of the static casters is
+         * kept in a separate texture and rendered again only when the layer
+         * volume changes or one of the static casters gets a new
+         * transformation. It's then copied into the shadow map before the
+         * dynamic casters are drawn on top. Without caching, the two are
+         * treated the same.
+         *
+         * In @ref ShadowMode::Variance, the depth of each layer that got
+         * drawn to is then turned into moments and blurred into its layer
+         * of @ref momentsTexture(), which is mipmapped at the end. Layers
+         * that kept their cached depth keep their moments as well.
+         */
+        void render(ShadowCasterShader& shader, UniformRing& uniforms, Containers::ArrayView<Model> models);
+
+        /**
+         * @brief Enable caching of static caster depth
+         *
+         * Allocates a private atlas holding a copy of every layer.
+         */
+        void setCachingEnabled(bool enabled);
+
+        bool isCachingEnabled() const { return _cachingEnabled; }
+
+        /**
+         * @brief Set how the shadow maps are stored
+         *
+         * Casters render only depth into the atlas in both modes.
+         * @ref ShadowMode::Variance additionally creates
+         * @ref momentsTexture() and disables depth comparison on the atlas,
+         * so the blur can read the depth.
+         */
+        void setShadowMode(ShadowMode mode);
+
+        ShadowMode shadowMode() const { return _mode; }
+
+        /** @brief Casters drawn by the last @ref render(), summed over layers */
+        std::size_t drawnCount() const { return _drawnCount; }
+
+        /** @brief Casters culled by the last @ref render(), summed over layers */
+        std::size_t culledCount() const { return _culledCount; }
+
+        /** @brief Layers that reused cached static depth in the last @ref render() */
+        std::size_t cachedLayerCount() const { return _cachedLayerCount; }
+
+        /** @brief Draw calls and triangles of the last @ref render() */
+        const DrawStatistics& statistics() const { return _statistics; }
+
+        /** @brief GPU memory taken by the static caster cache, in bytes */
+        std::size_t cacheMemoryUsage() const { return _staticAtlas.memoryUsage(); }
+
+        /**
+         * @brief GPU memory taken by the moments, in bytes
+         *
+         * Two floats per texel, the mip chain adds a third. Zero in
+         * @ref ShadowMode::Hard.
+         */
+        std::size_t momentsMemoryUsage() const;
+
+        /**
+         * @brief Distance of the far end of given layer from the camera
+         *
+         * Linear view-space depth, useful for displaying the split.
+         */
+        Float cutDistance(Float zNear, Float zFar, Int layer) const;
+
+        std::size_t layerCount() const { return _layers.size(); }
+
+        const Matrix4& layerMatrix(Int layer) const {
+            return _layers[layer].shadowMatrix;
+        }
+
+        /** @brief Shadow matrices of all layers, updated by @ref render() */
+        Containers::ArrayView<const Matrix4> layerMatrices() const {
+            return _layerMatrices;
+        }
+
+        /**
+         * @brief Texture coordinate rectangles of all layers
+         *
+         * In the atlas, or for @ref ShadowMode::Variance in the layer's
+         * moments. Updated by @ref render().
          */
-        void render(SceneGraph::DrawableGroup3D& drawables);
+        Containers::ArrayView<const Vector4> layerRects() const {
+            return _layerRects;
+        }
 
+        const Range2Di& layerTile(Int layer) const {
+            return _layers[layer].tile;
+        }
 
-        const Matrix4& layerMatrix() const {
-            return _data->shadowMatrix;
+        /**
+         * @brief Part of the layer tile that's rendered to
+         *
+         * The bottom left corner of @ref layerTile(), @ref viewportSize()
+         * big.
+         */
+        Range2Di layerViewport(Int layer) const {
+            return Range2Di::fromSize(_layers[layer].tile.min(), Vector2i{ viewportSize(layer) });
         }
 
-        Vector2i size() const { return _data->shadowFramebuffer.viewport().size(); }
+        /** @brief Size of the tile of the first, largest layer */
+        Int size() const { return _layers.front().tile.sizeX(); }
+
+        /**
+         * @brief Render only a part of each tile
+         *
+         * Shrinks the rendered area to @p scale of the tile size in each
+         * direction, which is expected to be in range @f$ (0, 1] @f$. The
+         * shadow matrices and atlas rectangles follow, so receivers sample
+         * only the rendered part. Nothing is reallocated, so the scale can
+         * change every frame. Cached static depth is rendered again when
+         * it does.
+         */
+        void setResolutionScale(Float scale);
+
+        Float resolutionScale() const { return _resolutionScale; }
+
+        /**
+         * @brief Size of the rendered part of a layer tile
+         *
+         * Size of @ref layerTile() scaled by @ref resolutionScale(), rounded
+         * up to a multiple of 8 texels.
+         */
+        Int viewportSize(Int layer = 0) const;
 
-        GL::Texture2D& shadowTexture() { return _shadowTexture; }
+        /**
+         * @brief Blurred moments of all layers
+         *
+         * One layer of @ref size() for each cascade, with a full mip chain.
+         * What receivers sample in @ref ShadowMode::Variance, the atlas
+         * depth in @ref ShadowMode::Hard.
+         */
+        GL::Texture2DArray& momentsTexture() { return _momentsTexture; }
 
     private:
+        struct ShadowLayerData;
+
+        void setupStaticCache();
+        void setupBlur();
+        void blurLayer(Int layer, const Range2Di& viewport);
+        static Frustum casterVolume(const ShadowLayerData& layer);
+        void drawCasters(std::initializer_list<std::size_t> tasks, const Matrix4& viewProjectionMatrix, ShadowCasterShader& shader, UniformRing& uniforms, Containers::ArrayView<Model> models);
+
         Object3D& _object;
-        GL::Texture2D _shadowTexture;
+        ShadowAtlas* _atlas{};
+        ShadowAtlas _staticAtlas{NoCreate};
 
-        struct ShadowData {
-            GL::Framebuffer shadowFramebuffer;
+        struct ShadowLayerData {
+            Range2Di tile;
             Matrix4 shadowCameraMatrix;
+
+            /* Inverse of the above. Moving the object to each layer and
+               cleaning it would allocate in the scene graph, so the rigid
+               transformation is inverted directly. */
+            Matrix4 layerCameraMatrix;
             Matrix4 shadowMatrix;
             Vector2 orthographicSize;
             Float orthographicNear, orthographicFar;
+
+            /* Bounding sphere radius of the main camera frustum slice. It
+               depends only on the projection, so the volume keeps its size
+               while the camera moves and turns. */
+            Float radius{};
+
+            /* Far end of the layer, in main camera NDC depth */
             Float cutPlane { 1.0f };
 
-            explicit ShadowData(const Vector2i& size);
+            /* Static caster depth and the shadow matrix it was rendered
+               with, used only with caching enabled */
+            Range2Di staticTile;
+            Matrix4 cachedShadowMatrix;
+            bool staticCacheValid { false };
+            bool hasDynamicCasters { false };
+
+            explicit ShadowLayerData(const Range2Di& atlasTile);
+        };
+
+        ShadowMode _mode{ ShadowMode::Hard };
+        ShadowBlurShader _depthBlurShader{NoCreate};
+        ShadowBlurShader _momentsBlurShader{NoCreate};
+        GL::Texture2D _blurTexture{NoCreate};
+        GL::Framebuffer _blurFramebuffer{NoCreate};
+        GL::Mesh _blurMesh{NoCreate};
+
+        /* Used only in variance mode, a framebuffer for each layer */
+        GL::Texture2DArray _momentsTexture{NoCreate};
+        std::vector<GL::Framebuffer> _momentsFramebuffers;
+
+        std::vector<ShadowLayerData> _layers;
+        std::vector<Matrix4> _layerMatrices;
+        std::vector<Vector4> _layerRects;
+
+        /* Main camera view projection seen by the last setTarget() and its
+           inverse, which is recalculated only when it changes. Same for the
+           projection alone and the layer radii. */
+        Matrix4 _mainViewProjection{ Math::ZeroInit };
+        Matrix4 _inverseMainViewProjection;
+        Matrix4 _mainProjection{ Math::ZeroInit };
+
+        /* What cull() found for one layer in one of the indices. Each task
+           writes only its own, so they can run in parallel. */
+        struct CullResult {
+            DrawableTransformations visible;
+            DrawList drawList;
+            Float orthographicNear;
+            std::size_t culledCount;
+            bool hasCasters;
         };
 
-        ShadowData* _data;
+        /* Static and dynamic casters of each layer, reused every frame */
+        std::vector<CullResult> _culled;
+        SpatialIndex* _staticCasters{};
+        SpatialIndex* _dynamicCasters{};
+        bool _staticCastersDirty{};
+
+        /* Set by the GPU variant of cull() for the current frame */
+        GpuCulling* _gpuCulling{};
+
+        /* Binding the mesh is most of the cost of a depth-only draw */
+        RenderQueue _queue{ RenderQueue::Order::State };
+
+        Float _resolutionScale{ 1.0f };
+        bool _cachingEnabled { true };
+        std::size_t _drawnCount{}, _culledCount{}, _cachedLayerCount{};
+        DrawStatistics _statistics;
 };
 
 }}
@@ -0,0 +1,43 @@
+#include "ShadowMath.h"
+
+#include <limits>
+#include <Magnum/Math/Functions.h>
+
+namespace Magnum { namespace Examples {
+
+FrustumCorners frustumCorners(const Matrix4& inverseViewProjection,
+                              const Float z0, const Float z1) {
+    const Matrix4& imvp = inverseViewProjection;
+    return {{ imvp.transformPoint({-1,-1, z0}),
+              imvp.transformPoint({ 1,-1, z0}),
+              imvp.transformPoint({-1, 1, z0}),
+              imvp.transformPoint({ 1, 1, z0}),
+              imvp.transformPoint({-1,-1, z1}),
+              imvp.transformPoint({ 1,-1, z1}),
+              imvp.transformPoint({-1, 1, z1}),
+              imvp.transformPoint({ 1, 1, z1}) }};
+}
+
+Range3D rotatedBounds(const FrustumCorners& corners, const Matrix3x3& rotation) {
+    Vector3 min { std::numeric_limits<Float>::max() };
+    Vector3 max { std::numeric_limits<Float>::lowest() };
+
+    for(const Vector3& corner: corners) {
+        const Vector3 rotated = rotation*corner;
+        min = Math::min(min, rotated);
+        max = Math::max(max, rotated);
+    }
+
+    return { min, max };
+}
+
+Float boundingRadius(const Containers::ArrayView<const Vector3> positions) {
+    /* Square root only once at the end */
+    Float radiusSquared = 0.0f;
+    for(const Vector3& position: positions) {
+        radiusSquared = Math::max(radiusSquared, position.dot());
+    }
+    return std::sqrt(radiusSquared);
+}
+
+}}
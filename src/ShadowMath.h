@@ -0,0 +1,40 @@
+#ifndef Magnum_Examples_Shadows_ShadowMath_h
+#define Magnum_Examples_Shadows_ShadowMath_h
+
+#include <array>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Range.h>
+
+namespace Magnum { namespace Examples {
+
+/*
+    Bounds math run every frame or for every mesh. Kept free of GL so it can
+    be measured on its own, see ShadowMathBenchmark.cpp.
+*/
+
+/** @brief Corners of a frustum slice, near ones first */
+typedef std::array<Vector3, 8> FrustumCorners;
+
+/**
+ * @brief Corners of a slice of a view frustum
+ * @param inverseViewProjection Inverted view projection matrix
+ * @param z0                    NDC depth of the near end
+ * @param z1                    NDC depth of the far end
+ */
+FrustumCorners frustumCorners(const Matrix4& inverseViewProjection, Float z0, Float z1);
+
+/**
+ * @brief Axis-aligned bounds of frustum corners in a rotated space
+ *
+ * @p rotation takes the corners from world space to the space the bounds
+ * are aligned to, usually the inverse light orientation.
+ */
+Range3D rotatedBounds(const FrustumCorners& corners, const Matrix3x3& rotation);
+
+/** @brief Radius of a sphere around the origin containing all positions */
+Float boundingRadius(Containers::ArrayView<const Vector3> positions);
+
+}}
+
+#endif
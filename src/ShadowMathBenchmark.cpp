@@ -0,0 +1,320 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/ArrayViewStl.h>
+#include <Corrade/TestSuite/Tester.h>
+#include <Corrade/Utility/FormatStl.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Intersection.h>
+#include <Magnum/Math/Quaternion.h>
+
+#include "ShadowMath.h"
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief CPU cost of the per-frame and per-mesh bounds math
+ *
+ * Needs no GL context. Every function is measured twice over the same
+ * input: the scalar variant is what the example runs, one object at a
+ * time from arrays of structures, the batched variant does the same math
+ * over structure-of-arrays data in plain loops the compiler can
+ * vectorize. Both report the time for the whole batch, run with
+ * `--benchmark cpu-time` or `--benchmark cpu-cycles` to switch clocks.
+ *
+ */
+struct ShadowMathBenchmark: TestSuite::Tester {
+    explicit ShadowMathBenchmark();
+
+    void frustumCornersScalar();
+    void frustumCornersBatched();
+    void rotatedBoundsScalar();
+    void rotatedBoundsBatched();
+    void boundingRadiusScalar();
+    void boundingRadiusBatched();
+    void sphereFrustumScalar();
+    void sphereFrustumBatched();
+
+    std::size_t instanceCount();
+};
+
+namespace {
+
+using namespace Math::Literals;
+
+constexpr std::size_t Counts[]{ 1000, 10000, 100000, 1000000 };
+
+/* NDC corners of a slice, in the order frustumCorners() returns them */
+constexpr Float CornerX[]{ -1.0f, 1.0f, -1.0f, 1.0f };
+constexpr Float CornerY[]{ -1.0f, -1.0f, 1.0f, 1.0f };
+
+Matrix4 inverseViewProjection() {
+    return (Matrix4::perspectiveProjection(60.0_degf, 16.0f/9.0f, 0.1f, 200.0f)*
+            Matrix4::lookAt({ 20.0f, 15.0f, 40.0f }, {}, Vector3::yAxis()).inverted()).inverted();
+}
+
+Matrix3x3 lightRotation() {
+    return Quaternion::rotation(35.0_degf, Vector3{ 1.0f, 0.5f, 0.2f }.normalized()).toMatrix().transposed();
+}
+
+/* Cascade splits, each slice somewhere between the near and far plane */
+void slices(const std::size_t count, std::vector<Float>& z0, std::vector<Float>& z1) {
+    std::mt19937 random{ 5489u };
+    std::uniform_real_distribution<Float> depth{ -1.0f, 1.0f };
+    z0.resize(count);
+    z1.resize(count);
+    for(std::size_t i = 0; i != count; ++i) {
+        const Float a = depth(random), b = depth(random);
+        z0[i] = Math::min(a, b);
+        z1[i] = Math::max(a, b);
+    }
+}
+
+std::vector<Vector3> points(const std::size_t count, const Float extent) {
+    std::mt19937 random{ 5489u };
+    std::uniform_real_distribution<Float> coordinate{ -extent, extent };
+    std::vector<Vector3> out(count);
+    for(Vector3& point: out) point = { coordinate(random), coordinate(random), coordinate(random) };
+    return out;
+}
+
+/* Transposed to one array per component */
+void split(const std::vector<Vector3>& in, Containers::Array<Float>& x, Containers::Array<Float>& y, Containers::Array<Float>& z) {
+    x = Containers::Array<Float>{ Containers::NoInit, in.size() };
+    y = Containers::Array<Float>{ Containers::NoInit, in.size() };
+    z = Containers::Array<Float>{ Containers::NoInit, in.size() };
+    for(std::size_t i = 0; i != in.size(); ++i) {
+        x[i] = in[i].x();
+        y[i] = in[i].y();
+        z[i] = in[i].z();
+    }
+}
+
+std::vector<FrustumCorners> cornerSets(const std::size_t count) {
+    std::vector<Float> z0, z1;
+    slices(count, z0, z1);
+    const Matrix4 imvp = inverseViewProjection();
+    std::vector<FrustumCorners> out(count);
+    for(std::size_t i = 0; i != count; ++i) out[i] = frustumCorners(imvp, z0[i], z1[i]);
+    return out;
+}
+
+}
+
+ShadowMathBenchmark::ShadowMathBenchmark() {
+    addInstancedBenchmarks({&ShadowMathBenchmark::frustumCornersScalar,
+                            &ShadowMathBenchmark::frustumCornersBatched,
+                            &ShadowMathBenchmark::rotatedBoundsScalar,
+                            &ShadowMathBenchmark::rotatedBoundsBatched,
+                            &ShadowMathBenchmark::boundingRadiusScalar,
+                            &ShadowMathBenchmark::boundingRadiusBatched,
+                            &ShadowMathBenchmark::sphereFrustumScalar,
+                            &ShadowMathBenchmark::sphereFrustumBatched},
+        5, Containers::arraySize(Counts));
+}
+
+std::size_t ShadowMathBenchmark::instanceCount() {
+    const std::size_t count = Counts[testCaseInstanceId()];
+    setTestCaseDescription(Utility::formatString("{}", count));
+    return count;
+}
+
+void ShadowMathBenchmark::frustumCornersScalar() {
+    const std::size_t count = instanceCount();
+    std::vector<Float> z0, z1;
+    slices(count, z0, z1);
+    const Matrix4 imvp = inverseViewProjection();
+    std::vector<FrustumCorners> out(count);
+
+    CORRADE_BENCHMARK(1) {
+        for(std::size_t i = 0; i != count; ++i) out[i] = frustumCorners(imvp, z0[i], z1[i]);
+    }
+
+    CORRADE_COMPARE(out.back()[7], frustumCorners(imvp, z0.back(), z1.back())[7]);
+}
+
+void ShadowMathBenchmark::frustumCornersBatched() {
+    const std::size_t count = instanceCount();
+    std::vector<Float> z0, z1;
+    slices(count, z0, z1);
+    const Matrix4 imvp = inverseViewProjection();
+
+    /* Corner-major, corner c of slice i is at c*count + i */
+    Containers::Array<Float> x{ Containers::NoInit, 8*count };
+    Containers::Array<Float> y{ Containers::NoInit, 8*count };
+    Containers::Array<Float> z{ Containers::NoInit, 8*count };
+
+    CORRADE_BENCHMARK(1) {
+        /* Only the depth differs between slices, so the matrix times the
+           other three components is done once per corner */
+        const Vector4 depth = imvp[2];
+        for(std::size_t c = 0; c != 8; ++c) {
+            const Vector4 base = CornerX[c % 4]*imvp[0] + CornerY[c % 4]*imvp[1] + imvp[3];
+            const Float* const zs = c < 4 ? z0.data() : z1.data();
+            Float* const xo = x.data() + c*count;
+            Float* const yo = y.data() + c*count;
+            Float* const zo = z.data() + c*count;
+            for(std::size_t i = 0; i != count; ++i) {
+                const Float invW = 1.0f/(base.w() + zs[i]*depth.w());
+                xo[i] = (base.x() + zs[i]*depth.x())*invW;
+                yo[i] = (base.y() + zs[i]*depth.y())*invW;
+                zo[i] = (base.z() + zs[i]*depth.z())*invW;
+            }
+        }
+    }
+
+    const FrustumCorners expected = frustumCorners(imvp, z0.back(), z1.back());
+    for(std::size_t c = 0; c != 8; ++c) {
+        const std::size_t i = c*count + count - 1;
+        CORRADE_COMPARE(Vector3(x[i], y[i], z[i]), expected[c]);
+    }
+}
+
+void ShadowMathBenchmark::rotatedBoundsScalar() {
+    const std::size_t count = instanceCount();
+    const std::vector<FrustumCorners> corners = cornerSets(count);
+    const Matrix3x3 rotation = lightRotation();
+    std::vector<Range3D> out(count);
+
+    CORRADE_BENCHMARK(1) {
+        for(std::size_t i = 0; i != count; ++i) out[i] = rotatedBounds(corners[i], rotation);
+    }
+
+    CORRADE_COMPARE(out.back(), rotatedBounds(corners.back(), rotation));
+}
+
+void ShadowMathBenchmark::rotatedBoundsBatched() {
+    const std::size_t count = instanceCount();
+    const std::vector<FrustumCorners> corners = cornerSets(count);
+    const Matrix3x3 rotation = lightRotation();
+
+    /* Corner-major, same as frustumCornersBatched() produces */
+    std::vector<Vector3> flat(8*count);
+    for(std::size_t i = 0; i != count; ++i)
+        for(std::size_t c = 0; c != 8; ++c) flat[c*count + i] = corners[i][c];
+    Containers::Array<Float> x, y, z;
+    split(flat, x, y, z);
+
+    Containers::Array<Float> min[3], max[3];
+    for(std::size_t j = 0; j != 3; ++j) {
+        min[j] = Containers::Array<Float>{ Containers::NoInit, count };
+        max[j] = Containers::Array<Float>{ Containers::NoInit, count };
+    }
+
+    CORRADE_BENCHMARK(1) {
+        for(std::size_t j = 0; j != 3; ++j) {
+            const Vector3 row = rotation.row(j);
+            Float* const mn = min[j];
+            Float* const mx = max[j];
+            for(std::size_t i = 0; i != count; ++i)
+                mn[i] = mx[i] = row.x()*x[i] + row.y()*y[i] + row.z()*z[i];
+            for(std::size_t c = 1; c != 8; ++c) {
+                const Float* const xs = x.data() + c*count;
+                const Float* const ys = y.data() + c*count;
+                const Float* const zs = z.data() + c*count;
+                for(std::size_t i = 0; i != count; ++i) {
+                    const Float v = row.x()*xs[i] + row.y()*ys[i] + row.z()*zs[i];
+                    mn[i] = Math::min(mn[i], v);
+                    mx[i] = Math::max(mx[i], v);
+                }
+            }
+        }
+    }
+
+    const Range3D expected = rotatedBounds(corners.back(), rotation);
+    CORRADE_COMPARE(Range3D(Vector3(min[0][count - 1], min[1][count - 1], min[2][count - 1]),
+                            Vector3(max[0][count - 1], max[1][count - 1], max[2][count - 1])),
+                    expected);
+}
+
+void ShadowMathBenchmark::boundingRadiusScalar() {
+    const std::size_t count = instanceCount();
+    const std::vector<Vector3> positions = points(count, 10.0f);
+    Float radius = 0.0f;
+
+    CORRADE_BENCHMARK(1) {
+        radius = boundingRadius(positions);
+    }
+
+    CORRADE_VERIFY(radius > 0.0f);
+}
+
+void ShadowMathBenchmark::boundingRadiusBatched() {
+    const std::size_t count = instanceCount();
+    const std::vector<Vector3> positions = points(count, 10.0f);
+    Containers::Array<Float> x, y, z;
+    split(positions, x, y, z);
+    Float radius = 0.0f;
+
+    CORRADE_BENCHMARK(1) {
+        /* Independent lanes, a single running maximum would be a serial
+           dependency the compiler isn't allowed to reorder */
+        constexpr std::size_t Lanes = 8;
+        Float lanes[Lanes]{};
+        std::size_t i = 0;
+        for(; i + Lanes <= count; i += Lanes)
+            for(std::size_t l = 0; l != Lanes; ++l)
+                lanes[l] = Math::max(lanes[l], x[i + l]*x[i + l] + y[i + l]*y[i + l] + z[i + l]*z[i + l]);
+        for(; i != count; ++i)
+            lanes[0] = Math::max(lanes[0], x[i]*x[i] + y[i]*y[i] + z[i]*z[i]);
+
+        Float radiusSquared = 0.0f;
+        for(const Float lane: lanes) radiusSquared = Math::max(radiusSquared, lane);
+        radius = std::sqrt(radiusSquared);
+    }
+
+    CORRADE_COMPARE(radius, boundingRadius(positions));
+}
+
+void ShadowMathBenchmark::sphereFrustumScalar() {
+    const std::size_t count = instanceCount();
+    const std::vector<Vector3> centers = points(count, 100.0f);
+    const Frustum frustum = Frustum::fromMatrix(inverseViewProjection().inverted());
+    std::size_t visible = 0;
+
+    CORRADE_BENCHMARK(1) {
+        visible = 0;
+        for(std::size_t i = 0; i != count; ++i)
+            if(Math::Intersection::sphereFrustum(centers[i], 1.0f, frustum)) ++visible;
+    }
+
+    CORRADE_VERIFY(visible > 0 && visible < count);
+}
+
+void ShadowMathBenchmark::sphereFrustumBatched() {
+    const std::size_t count = instanceCount();
+    const std::vector<Vector3> centers = points(count, 100.0f);
+    const Frustum frustum = Frustum::fromMatrix(inverseViewProjection().inverted());
+    Containers::Array<Float> x, y, z;
+    split(centers, x, y, z);
+    Containers::Array<Float> radii{ Containers::DirectInit, count, 1.0f };
+    Containers::Array<UnsignedByte> inside{ Containers::NoInit, count };
+    std::size_t visible = 0;
+
+    CORRADE_BENCHMARK(1) {
+        /* One plane at a time over all spheres, the same test as
+           Math::Intersection::sphereFrustum() does */
+        for(std::size_t i = 0; i != count; ++i) inside[i] = 1;
+        for(std::size_t p = 0; p != 6; ++p) {
+            const Vector4& plane = frustum[p];
+            for(std::size_t i = 0; i != count; ++i) {
+                const Float distance = plane.x()*x[i] + plane.y()*y[i] + plane.z()*z[i] + plane.w();
+                inside[i] &= UnsignedByte(distance >= -radii[i]*radii[i]);
+            }
+        }
+
+        visible = 0;
+        for(std::size_t i = 0; i != count; ++i) visible += inside[i];
+    }
+
+    std::size_t expected = 0;
+    for(const Vector3& center: centers)
+        if(Math::Intersection::sphereFrustum(center, 1.0f, frustum)) ++expected;
+    CORRADE_COMPARE(visible, expected);
+}
+
+}}
+
+CORRADE_TEST_MAIN(Magnum::Examples::ShadowMathBenchmark)
@@ -1,12 +1,40 @@
-uniform float shadowBias;
+/* Bias, atlas rectangles and the light direction come from the
+   FrameUniforms block */
+
+#ifdef VARIANCE_SHADOW_MAP
+/* A layer of moments for each cascade, the rectangles and coordinates are
+   within the layer */
+uniform highp sampler2DArray shadowmapTexture;
+#else
 uniform sampler2DShadow shadowmapTexture;
-uniform highp vec3 lightDirection;
+#endif
 
 in mediump vec3 transformedNormal;
-in highp vec3 shadowCoord;
+in highp vec3 shadowCoords[NUM_SHADOW_MAP_LEVELS];
 
 out lowp vec4 color;
 
+#ifdef VARIANCE_SHADOW_MAP
+/* Keeps flat areas, where the blurred depth has next to no variance, from
+   flickering */
+const highp float minVariance = 0.00002;
+
+/* Probabilities below this are treated as fully in shadow. Hides the
+   light leaking through where shadows of several casters overlap. */
+const float lightBleedingReduction = 0.2;
+
+/* Chebyshev's upper bound of the fraction of light reaching the depth */
+float varianceShadow(highp vec2 moments, highp float depth) {
+    if (depth <= moments.x)
+        return 1.0;
+
+    highp float variance = max(moments.y - moments.x * moments.x, minVariance);
+    highp float d = depth - moments.x;
+    float pMax = variance / (variance + d * d);
+    return clamp((pMax - lightBleedingReduction) / (1.0 - lightBleedingReduction), 0.0, 1.0);
+}
+#endif
+
 void main() {
     /* You might want to source this from a texture or a vertex color */
     vec3 albedo = vec3(0.5, 0.5, 0.5);
@@ -18,6 +46,17 @@ void main() {
 
     float inverseShadow = 1.0;
 
+#ifdef VARIANCE_SHADOW_MAP
+    /* Derivatives are undefined in non-uniform control flow, which the
+       lookup below is in, so get them for all cascades up front */
+    highp vec2 shadowCoordDx[NUM_SHADOW_MAP_LEVELS];
+    highp vec2 shadowCoordDy[NUM_SHADOW_MAP_LEVELS];
+    for (int level = 0; level < NUM_SHADOW_MAP_LEVELS; level++) {
+        shadowCoordDx[level] = dFdx(shadowCoords[level].xy);
+        shadowCoordDy[level] = dFdy(shadowCoords[level].xy);
+    }
+#endif
+
     /* Is the normal of this face pointing towards the light? */
     lowp float intensity = dot(normalizedTransformedNormal, lightDirection);
 
@@ -28,10 +67,32 @@ void main() {
         intensity = 0.0f;
 
     } else {
-        inverseShadow = texture(shadowmapTexture, vec3(
-            shadowCoord.xy,
-            shadowCoord.z - shadowBias)
-        );
+        /* Starting with the highest resolution cascade, find the first one
+           this fragment falls into. Outside of all of them it's lit. The
+           coordinates are already in the atlas or the moments layer, so
+           check against the cascade's rectangle in it. */
+        for (int level = 0; level < NUM_SHADOW_MAP_LEVELS; level++) {
+            highp vec3 shadowCoord = shadowCoords[level];
+            highp vec4 rect = shadowmapRect[level];
+            bool inRange = shadowCoord.x >= rect.x && shadowCoord.x < rect.z &&
+                           shadowCoord.y >= rect.y && shadowCoord.y < rect.w &&
+                           shadowCoord.z >= 0.0 && shadowCoord.z < 1.0;
+
+            if (inRange) {
+#ifdef VARIANCE_SHADOW_MAP
+                inverseShadow = varianceShadow(
+                    textureGrad(shadowmapTexture, vec3(shadowCoord.xy, float(level)),
+                                shadowCoordDx[level], shadowCoordDy[level]).rg,
+                    shadowCoord.z - shadowBias);
+#else
+                inverseShadow = texture(shadowmapTexture, vec3(
+                    shadowCoord.xy,
+                    shadowCoord.z - shadowBias)
+                );
+#endif
+                break;
+            }
+        }
     }
 
     color.rgba = vec4((ambient + vec3(intensity * inverseShadow)) * albedo, 1.0);
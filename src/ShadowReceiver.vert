@@ -1,18 +1,21 @@
-uniform highp mat4 modelMatrix;
-uniform highp mat4 transformationProjectionMatrix;
-uniform highp mat4 shadowmapMatrix;
+/* Matrices come from the FrameUniforms and DrawUniforms blocks */
 
 in highp vec4 position;
 in mediump vec3 normal;
 
+/* Per-instance */
+in highp mat4 modelMatrix;
+
 out mediump vec3 transformedNormal;
 
-out highp vec3 shadowCoord;
+out highp vec3 shadowCoords[NUM_SHADOW_MAP_LEVELS];
 
 void main() {
     transformedNormal = mat3(modelMatrix) * normal;
 
     vec4 worldPos4 = modelMatrix * position;
-    shadowCoord = (shadowmapMatrix * worldPos4).xyz;
-    gl_Position = transformationProjectionMatrix * position;
+    for (int i = 0; i < NUM_SHADOW_MAP_LEVELS; i++) {
+        shadowCoords[i] = (shadowmapMatrix[i] * worldPos4).xyz;
+    }
+    gl_Position = viewProjectionMatrix * worldPos4;
 }
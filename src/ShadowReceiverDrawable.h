@@ -1,29 +1,37 @@
 #ifndef Magnum_Examples_Shadows_ShadowReceiverDrawable_h
 #define Magnum_Examples_Shadows_ShadowReceiverDrawable_h
 
-#include <Magnum/GL/Mesh.h>
 #include <Magnum/SceneGraph/Drawable.h>
 
 namespace Magnum { namespace Examples {
 
-class ShadowReceiverShader;
-class ShadowLight;
+struct Model;
 
-/** @brief Drawable that should render shadows cast by casters */
+/**
+ * @brief Drawable that should render shadows cast by casters
+ *
+ * Holds just the model, the object gets drawn as its instance through a
+ * @ref DrawList.
+ */
 class ShadowReceiverDrawable: public SceneGraph::Drawable3D {
     public:
         explicit ShadowReceiverDrawable(SceneGraph::AbstractObject3D& object, SceneGraph::DrawableGroup3D* drawables);
 
         void draw(const Matrix4 &transformationMatrix, SceneGraph::Camera3D& camera) override;
 
-        GL::Mesh& mesh() { return *_mesh; }
-        void setMesh(GL::Mesh& mesh) { _mesh = &mesh; }
+        Model& model() { return *_model; }
+        void setModel(Model& model) { _model = &model; }
 
-        void setShader(ShadowReceiverShader& shader) { _shader = &shader; }
+        /** @brief LOD level picked for the last frame, see @ref Model::lod() */
+        UnsignedInt lod() const { return _lod; }
+        void setLod(UnsignedInt lod) { _lod = lod; }
+
+        /** @brief Model-space bounding sphere radius, used for culling */
+        Float radius() const;
 
     private:
-        GL::Mesh* _mesh{};
-        ShadowReceiverShader* _shader{};
+        Model* _model{};
+        UnsignedInt _lod{};
 };
 
 }}
@@ -5,70 +5,72 @@
 #include <Magnum/GL/Context.h>
 #include <Magnum/GL/Shader.h>
 #include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureArray.h>
 #include <Magnum/GL/Version.h>
-#include <Magnum/Math/Matrix4.h>
+
+#include "ProgramBinaryCache.h"
+#include "Uniforms.h"
 
 namespace Magnum { namespace Examples {
 
-ShadowReceiverShader::ShadowReceiverShader() {
+std::string ShadowReceiverShader::defines(const Int numShadowLevels,
+                                          const ShadowMode mode) {
+    std::string defines = "#define NUM_SHADOW_MAP_LEVELS " + std::to_string(numShadowLevels) + "\n"
+                          "#define MAX_SHADOW_MAP_LEVELS " + std::to_string(MaxShadowMapLevels) + "\n";
+    if(mode == ShadowMode::Variance) defines += "#define VARIANCE_SHADOW_MAP\n";
+    return defines;
+}
+
+ShadowReceiverShader::ShadowReceiverShader(const Int numShadowLevels,
+                                           const ShadowMode mode,
+                                           ProgramBinaryCache* const binaryCache)
+    : _numShadowLevels{numShadowLevels}, _mode{mode} {
     MAGNUM_ASSERT_GL_VERSION_SUPPORTED(GL::Version::GL330);
+    CORRADE_INTERNAL_ASSERT(numShadowLevels >= 1 && numShadowLevels <= MaxShadowMapLevels);
 
     const Utility::Resource rs{"shadow-data"};
 
     GL::Shader vert{ GL::Version::GL330, GL::Shader::Type::Vertex };
     GL::Shader frag{ GL::Version::GL330, GL::Shader::Type::Fragment };
 
-    std::string preamble = "#define NUM_SHADOW_MAP_LEVELS " + std::to_string(1) + "\n";
+    const std::string preamble = defines(numShadowLevels, mode);
     vert.addSource(preamble);
+    vert.addSource(rs.get("Uniforms.glsl"));
     vert.addSource(rs.get("ShadowReceiver.vert"));
     frag.addSource(preamble);
+    frag.addSource(rs.get("Uniforms.glsl"));
     frag.addSource(rs.get("ShadowReceiver.frag"));
 
-    CORRADE_INTERNAL_ASSERT_OUTPUT(GL::Shader::compile({vert, frag}));
+    if(!binaryCache || !binaryCache->load(*this, {vert, frag})) {
+        CORRADE_INTERNAL_ASSERT_OUTPUT(GL::Shader::compile({vert, frag}));
 
-    bindAttributeLocation(Position::Location, "position");
-    bindAttributeLocation(Normal::Location, "normal");
+        bindAttributeLocation(Position::Location, "position");
+        bindAttributeLocation(Normal::Location, "normal");
+        bindAttributeLocation(TransformationMatrix::Location, "modelMatrix");
 
-    attachShaders({vert, frag});
+        attachShaders({vert, frag});
 
-    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+        if(binaryCache) binaryCache->prepare(*this);
+        CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+        if(binaryCache) binaryCache->save(*this, {vert, frag});
+    }
 
-    _modelMatrixUniform = uniformLocation("modelMatrix");
-    _transformationProjectionMatrixUniform = uniformLocation("transformationProjectionMatrix");
-    _shadowmapMatrixUniform = uniformLocation("shadowmapMatrix");
-    _lightDirectionUniform = uniformLocation("lightDirection");
-    _shadowBiasUniform = uniformLocation("shadowBias");
+    /* Every variant reads the same blocks, bound once by whoever draws */
+    setUniformBlockBinding(uniformBlockIndex("FrameUniforms"), FrameUniformBinding);
+    setUniformBlockBinding(uniformBlockIndex("DrawUniforms"), DrawUniformBinding);
 
     setUniform(uniformLocation("shadowmapTexture"), ShadowmapTextureLayer);
 }
 
-ShadowReceiverShader& ShadowReceiverShader::setTransformationProjectionMatrix(const Matrix4& matrix) {
-    setUniform(_transformationProjectionMatrixUniform, matrix);
-    return *this;
-}
-
-ShadowReceiverShader& ShadowReceiverShader::setModelMatrix(const Matrix4& matrix) {
-    setUniform(_modelMatrixUniform, matrix);
-    return *this;
-}
-
-ShadowReceiverShader& ShadowReceiverShader::setShadowmapMatrix(const Matrix4 matrix) {
-    setUniform(_shadowmapMatrixUniform, matrix);
-    return *this;
-}
-
-ShadowReceiverShader& ShadowReceiverShader::setLightDirection(const Vector3& vector) {
-    setUniform(_lightDirectionUniform, vector);
-    return *this;
-}
-
 ShadowReceiverShader& ShadowReceiverShader::setShadowmapTexture(GL::Texture2D& texture) {
+    CORRADE_INTERNAL_ASSERT(_mode == ShadowMode::Hard);
     texture.bind(ShadowmapTextureLayer);
     return *this;
 }
 
-ShadowReceiverShader& ShadowReceiverShader::setShadowBias(const Float bias) {
-    setUniform(_shadowBiasUniform, bias);
+ShadowReceiverShader& ShadowReceiverShader::setShadowmapTexture(GL::Texture2DArray& texture) {
+    CORRADE_INTERNAL_ASSERT(_mode == ShadowMode::Variance);
+    texture.bind(ShadowmapTextureLayer);
     return *this;
 }
 
@@ -1,65 +1,79 @@
 #ifndef Magnum_Examples_Shadows_ShadowReceiverShader_h
 #define Magnum_Examples_Shadows_ShadowReceiverShader_h
 
+#include <string>
 #include <Magnum/GL/AbstractShaderProgram.h>
 #include <Magnum/Shaders/Generic.h>
 
+#include "Types.h"
+
 namespace Magnum { namespace Examples {
 
-/** @brief Shader that can synthesize shadows on an object */
+class ProgramBinaryCache;
+
+/**
+ * @brief Shader that can synthesize shadows on an object
+ *
+ * The shadow matrices, atlas rectangles, light direction and bias are read
+ * from a @ref FrameUniforms block bound at @ref FrameUniformBinding and the
+ * view projection matrix from a @ref DrawUniforms block at
+ * @ref DrawUniformBinding. Only the cascades up to the level count are
+ * used, the rest of the frame block is ignored.
+ */
 class ShadowReceiverShader: public GL::AbstractShaderProgram {
     public:
         typedef Shaders::Generic3D::Position Position;
         typedef Shaders::Generic3D::Normal Normal;
 
-        explicit ShadowReceiverShader(NoCreateT): GL::AbstractShaderProgram{NoCreate} {}
-
-        explicit ShadowReceiverShader();
+        /** @brief Per-instance model matrix */
+        typedef Shaders::Generic3D::TransformationMatrix TransformationMatrix;
 
         /**
-         * @brief Set transformation and projection matrix
+         * @brief Defines a variant is compiled with
          *
-         * Matrix that transforms from local model space -> world space ->
-         * camera space -> clip coordinates (aka model-view-projection matrix).
+         * Different for each variant, see @ref ShaderVariants.
          */
-        ShadowReceiverShader& setTransformationProjectionMatrix(const Matrix4& matrix);
+        static std::string defines(Int numShadowLevels, ShadowMode mode);
+
+        explicit ShadowReceiverShader(NoCreateT): GL::AbstractShaderProgram{NoCreate} {}
 
         /**
-         * @brief Set model matrix
-         *
-         * Matrix that transforms from local model space -> world space (used
-         * for lighting).
+         * @brief Constructor
+         * @param numShadowLevels   Number of shadow map cascades, injected
+         *      into the GLSL source as `NUM_SHADOW_MAP_LEVELS`. At most
+         *      @ref MaxShadowMapLevels.
+         * @param mode              What the shadow map texture contains. With
+         *      @ref ShadowMode::Variance it's a texture array with a layer
+         *      for each cascade, sampled filtered and expected to have
+         *      mipmaps.
+         * @param binaryCache       Where to take the linked program from,
+         *      and store it to if it's not there. Compiled every time if
+         *      @cpp nullptr @ce.
          */
-        ShadowReceiverShader& setModelMatrix(const Matrix4& matrix);
+        explicit ShadowReceiverShader(Int numShadowLevels = 1, ShadowMode mode = ShadowMode::Hard, ProgramBinaryCache* binaryCache = nullptr);
 
         /**
-         * @brief Set shadowmap matrix
+         * @brief Set shadow map atlas texture
          *
-         * Matrix that transforms from world space -> shadow texture space.
+         * For @ref ShadowMode::Hard.
          */
-        ShadowReceiverShader& setShadowmapMatrix(const Matrix4 matrix);
-
-        /** @brief Set world-space direction to the light source */
-        ShadowReceiverShader& setLightDirection(const Vector3& vector3);
-
-        /** @brief Set shadow map texture array */
         ShadowReceiverShader& setShadowmapTexture(GL::Texture2D& texture);
 
         /**
-         * @brief Set thadow bias uniform
+         * @brief Set shadow map moments texture
          *
-         * Normally it wants to be something from 0.0001 -> 0.001.
+         * For @ref ShadowMode::Variance, see @ref ShadowLight::momentsTexture().
          */
-        ShadowReceiverShader& setShadowBias(Float bias);
+        ShadowReceiverShader& setShadowmapTexture(GL::Texture2DArray& texture);
+
+        Int shadowLevelCount() const { return _numShadowLevels; }
+        ShadowMode shadowMode() const { return _mode; }
 
     private:
         enum: Int { ShadowmapTextureLayer = 0 };
 
-        Int _modelMatrixUniform,
-            _transformationProjectionMatrixUniform,
-            _shadowmapMatrixUniform,
-            _lightDirectionUniform,
-            _shadowBiasUniform;
+        Int _numShadowLevels;
+        ShadowMode _mode;
 };
 
 }}
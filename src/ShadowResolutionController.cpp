@@ -0,0 +1,57 @@
+#include "ShadowResolutionController.h"
+
+#include <cmath>
+#include <Magnum/Math/Functions.h>
+
+namespace Magnum { namespace Examples {
+
+namespace {
+
+/* Weight of a new sample in the moving average */
+constexpr Float Smoothing = 0.2f;
+
+/* Going up only below this fraction of the budget */
+constexpr Float Headroom = 0.8f;
+
+/* Most the scale changes by in one frame */
+constexpr Float MaxDecrease = 0.85f;
+constexpr Float MaxIncrease = 1.02f;
+
+}
+
+ShadowResolutionController::ShadowResolutionController(const Float budget,
+                                                       const Float minScale):
+    _budget{budget}, _minScale{minScale} {}
+
+Float ShadowResolutionController::update(const Float gpuTime,
+                                         const std::size_t measuredFrame,
+                                         const std::size_t nextFrame) {
+    /* Frames at the previous scale would push it further in the same
+       direction */
+    if(gpuTime <= 0.0f || measuredFrame < _scaleFrame) return _scale;
+
+    _averageTime = _averageTime > 0.0f ?
+        Math::lerp(_averageTime, gpuTime, Smoothing) : gpuTime;
+
+    /* Rasterization cost goes with the area, so the side with its square
+       root */
+    const Float ratio = std::sqrt(_budget/_averageTime);
+    Float scale = _scale;
+    if(_averageTime > _budget) {
+        scale *= Math::max(ratio, MaxDecrease);
+    } else if(_averageTime < _budget*Headroom) {
+        scale *= Math::min(ratio, MaxIncrease);
+    }
+    scale = Math::clamp(scale, _minScale, 1.0f);
+
+    /* The average continues from what the new area is expected to take */
+    if(scale != _scale) {
+        _averageTime *= (scale/_scale)*(scale/_scale);
+        _scale = scale;
+        _scaleFrame = nextFrame;
+    }
+
+    return _scale;
+}
+
+}}
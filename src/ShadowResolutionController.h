@@ -0,0 +1,57 @@
+#ifndef Magnum_Examples_Shadows_ShadowResolutionController_h
+#define Magnum_Examples_Shadows_ShadowResolutionController_h
+
+#include <cstddef>
+#include <Magnum/Magnum.h>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Keeps the shadow pass within a GPU time budget
+ *
+ * Fed with every new measurement of the shadow pass GPU time, picks the
+ * @ref ShadowLight::setResolutionScale() for the next frames. The time is
+ * smoothed first, as it's noisy and arrives a few frames late. Going down
+ * is quick, going back up slow and only once there's enough headroom, so
+ * the resolution doesn't oscillate around the budget.
+ *
+ */
+class ShadowResolutionController {
+    public:
+        /**
+         * @brief Constructor
+         * @param budget    Shadow pass GPU time to stay under, in
+         *      milliseconds
+         * @param minScale  Lowest resolution scale to go to
+         */
+        explicit ShadowResolutionController(Float budget = 2.0f, Float minScale = 0.25f);
+
+        void setBudget(Float budget) { _budget = budget; }
+        Float budget() const { return _budget; }
+
+        Float scale() const { return _scale; }
+
+        /**
+         * @brief Take a new measurement
+         * @param gpuTime       Shadow pass GPU time, in milliseconds
+         * @param measuredFrame Frame the time was measured in
+         * @param nextFrame     Frame the returned scale is used for first
+         *
+         * Expects each measurement to be passed only once, as soon as it
+         * arrives. After the scale changes, it's held until a frame
+         * rendered with it gets measured, the times of frames before
+         * @p nextFrame of that call are ignored. Zero times are ignored as
+         * well. Returns the scale to render @p nextFrame with.
+         */
+        Float update(Float gpuTime, std::size_t measuredFrame, std::size_t nextFrame);
+
+    private:
+        Float _budget, _minScale;
+        Float _scale{ 1.0f };
+        Float _averageTime{};
+        std::size_t _scaleFrame{};
+};
+
+}}
+
+#endif
@@ -0,0 +1,337 @@
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <Corrade/Containers/Pointer.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Renderbuffer.h>
+#include <Magnum/GL/RenderbufferFormat.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/GL/TimeQuery.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/SceneGraph/Object.h>
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+
+#ifdef CORRADE_TARGET_WINDOWS
+#include <Magnum/Platform/WindowlessWglApplication.h>
+#elif defined(CORRADE_TARGET_APPLE)
+#include <Magnum/Platform/WindowlessCglApplication.h>
+#else
+#include <Magnum/Platform/WindowlessGlxApplication.h>
+#endif
+
+#include "AllocationCounter.h"
+#include "SceneLoader.h"
+#include "ShadowResolutionController.h"
+#include "ShadowsScene.h"
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Render the example scene offscreen and report frame timings
+ *
+ * The camera either orbits the scene or follows a recorded path, one
+ * `px py pz tx ty tz` line (eye position and target) per frame. Each pass
+ * is timed on the GPU with a time query, so the results are comparable
+ * between runs independently of vsync and window compositing.
+ *
+ * Heap allocations are counted for every frame as well. That frames don't
+ * allocate once the scratch buffers have grown is checked by
+ * `FrameAllocationTest`, the counts here only show where they did.
+ *
+ */
+class ShadowsBenchmark: public Platform::WindowlessApplication {
+    public:
+        explicit ShadowsBenchmark(const Arguments& arguments);
+
+        int exec() override;
+
+    private:
+        struct CameraKey {
+            Vector3 position;
+            Vector3 target;
+        };
+
+        struct FrameResult {
+            Double cpuMs;
+            Double shadowGpuMs;
+            Double mainGpuMs;
+            Float shadowScale;
+            DrawStatistics shadowStatistics;
+            DrawStatistics mainStatistics;
+            std::size_t drawn;
+            std::size_t occluded;
+            std::size_t allocations;
+        };
+
+        bool loadPath(const std::string& filename);
+        void orbitPath(Int frameCount);
+        bool writeResults(const std::string& filename, const std::vector<FrameResult>& results) const;
+
+        Utility::Arguments _args;
+        std::vector<CameraKey> _path;
+        Vector2i _size;
+        std::size_t _workerThreads{};
+        std::vector<CompactMeshStatistics> _meshStatistics;
+        Double _loadMs{};
+};
+
+ShadowsBenchmark::ShadowsBenchmark(const Arguments& arguments):
+    Platform::WindowlessApplication{ arguments, NoCreate }
+{
+    _args.addOption("frames", "300").setHelp("frames", "frames to render, the path is repeated if shorter", "N")
+         .addOption("size", "1280 720").setHelp("size", "framebuffer size", "\"X Y\"")
+         .addOption("shadow-map-size", "1024").setHelp("shadow-map-size", "shadow map size", "N")
+         .addOption("shadow-map-levels", "4").setHelp("shadow-map-levels", "shadow map cascade count", "N")
+         .addOption("shadow-budget", "0").setHelp("shadow-budget", "shadow pass GPU time to adapt the shadow map resolution to, fixed resolution if zero", "MS")
+         .addOption("shadow-mode", "hard").setHelp("shadow-mode", "hard, or variance for filtered shadows", "NAME")
+         .addOption("path").setHelp("path", "recorded camera path, orbit the scene if not set", "FILE")
+         .addOption("output", "benchmark.json").setHelp("output", "where to write the results", "FILE")
+         .addOption("lod-bias", "1").setHelp("lod-bias", "scale of the projected size main pass LODs are picked by", "BIAS")
+         .addOption("shadow-lod-bias", "0.5").setHelp("shadow-lod-bias", "scale of the projected size shadow pass LODs are picked by", "BIAS")
+         .addOption("threads").setHelp("threads", "worker threads for culling, one less than hardware threads by default", "N")
+         .addBooleanOption("gpu-culling").setHelp("gpu-culling", "cull and draw on the GPU, needs OpenGL 4.3")
+         .addBooleanOption("occlusion-culling").setHelp("occlusion-culling", "skip objects hidden in the depth of earlier frames")
+         .addSkippedPrefix("magnum", "engine-specific options")
+         .setGlobalHelp("Renders the shadows example offscreen and measures per-pass timings.");
+    SceneOptions::addArguments(_args);
+    _args.parse(arguments.argc, arguments.argv);
+
+    _size = _args.value<Vector2i>("size");
+
+    createContext();
+}
+
+bool ShadowsBenchmark::loadPath(const std::string& filename) {
+    std::ifstream in{ filename };
+    if(!in) {
+        Error() << "Can't open camera path" << filename;
+        return false;
+    }
+
+    CameraKey key;
+    while(in >> key.position.x() >> key.position.y() >> key.position.z()
+             >> key.target.x() >> key.target.y() >> key.target.z()) {
+        _path.push_back(key);
+    }
+
+    if(_path.empty()) {
+        Error() << "No camera keys in" << filename;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Circle the middle of the scene once, slightly above the objects and
+ * looking a bit down, so both near and far cascades are in use.
+ *
+ */
+void ShadowsBenchmark::orbitPath(const Int frameCount) {
+    _path.reserve(frameCount);
+    for(Int i = 0; i != frameCount; ++i) {
+        const Rad angle = Rad{ Constants::tau() * Float(i) / Float(frameCount) };
+        _path.push_back({
+            { Math::sin(angle) * 30.0f, 6.0f, Math::cos(angle) * 30.0f },
+            { 0.0f, 1.0f, 0.0f }
+        });
+    }
+}
+
+int ShadowsBenchmark::exec() {
+    const Int frameCount = _args.value<Int>("frames");
+    if(frameCount < 1) {
+        Error() << "At least one frame has to be rendered";
+        return 1;
+    }
+
+    if(_args.value("path").empty()) {
+        orbitPath(frameCount);
+    } else if(!loadPath(_args.value("path"))) {
+        return 1;
+    }
+
+    _workerThreads = _args.value("threads").empty() ?
+        ThreadPool::defaultWorkerCount() : _args.value<std::size_t>("threads");
+    const Containers::Optional<SceneOptions> parsed = SceneOptions::fromArguments(_args);
+    if(!parsed) return 1;
+    const SceneOptions& options = *parsed;
+    const auto loadBegin = std::chrono::steady_clock::now();
+    ShadowsScene scene{ _workerThreads, options.shaderCache };
+    if(!options.file.empty()) {
+        /* Loaded completely before the first frame, so the timings don't
+           depend on how fast the file comes in */
+        SceneLoader loader{ options.file, _workerThreads, options.meshCache };
+        while(loader.upload(scene, std::chrono::milliseconds{ 100 })) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+        }
+        if(loader.isFailed()) return 1;
+    } else {
+        scene.populate(options);
+    }
+    _loadMs = std::chrono::duration<Double, std::milli>(
+        std::chrono::steady_clock::now() - loadBegin).count();
+    for(const Model& model: scene.models()) {
+        _meshStatistics.push_back(model.meshStatistics);
+    }
+    scene.setViewport(_size);
+    if(_args.value("shadow-mode") == "variance") {
+        scene.setShadowMode(ShadowMode::Variance);
+    } else if(_args.value("shadow-mode") != "hard") {
+        Error() << "Unknown shadow mode" << _args.value("shadow-mode");
+        return 1;
+    }
+    if(!scene.setupShadowmaps(_args.value<Int>("shadow-map-levels"),
+                              _args.value<Int>("shadow-map-size"))) {
+        return 1;
+    }
+    scene.setLodBias(_args.value<Float>("lod-bias"));
+    scene.setShadowLodBias(_args.value<Float>("shadow-lod-bias"));
+    if(_args.isSet("gpu-culling") && !scene.setGpuCullingEnabled(true)) {
+        return 1;
+    }
+    scene.setOcclusionCullingEnabled(_args.isSet("occlusion-culling"));
+
+    GL::Renderbuffer color, depth;
+    color.setStorage(GL::RenderbufferFormat::RGBA8, _size);
+    depth.setStorage(GL::RenderbufferFormat::DepthComponent24, _size);
+
+    GL::Framebuffer framebuffer{ { {}, _size } };
+    framebuffer
+        .attachRenderbuffer(GL::Framebuffer::ColorAttachment{ 0 }, color)
+        .attachRenderbuffer(GL::Framebuffer::BufferAttachment::Depth, depth);
+    CORRADE_INTERNAL_ASSERT(framebuffer.checkStatus(GL::FramebufferTarget::Draw) ==
+                            GL::Framebuffer::Status::Complete);
+
+    const Float shadowBudget = _args.value<Float>("shadow-budget");
+    ShadowResolutionController shadowResolution{ shadowBudget };
+
+    GL::TimeQuery shadowQuery{ GL::TimeQuery::Target::TimeElapsed };
+    GL::TimeQuery mainQuery{ GL::TimeQuery::Target::TimeElapsed };
+
+    std::vector<FrameResult> results;
+    results.reserve(frameCount);
+
+    for(Int i = 0; i != frameCount; ++i) {
+        const CameraKey& key = _path[i % _path.size()];
+        scene.cameraObject().setTransformation(
+            Matrix4::lookAt(key.position, key.target, Vector3::yAxis()));
+
+        const std::size_t allocationsBefore = allocationCount();
+        const auto begin = std::chrono::high_resolution_clock::now();
+
+        shadowQuery.begin();
+        scene.drawShadows();
+        shadowQuery.end();
+
+        mainQuery.begin();
+        scene.draw(framebuffer);
+        mainQuery.end();
+
+        const auto end = std::chrono::high_resolution_clock::now();
+        const std::size_t allocations = allocationCount() - allocationsBefore;
+
+        /* Waits for the GPU, which is why it's outside of the CPU timing */
+        FrameResult result;
+        result.cpuMs = std::chrono::duration<Double, std::milli>(end - begin).count();
+        result.shadowGpuMs = shadowQuery.result<UnsignedLong>() / 1.0e6;
+        result.mainGpuMs = mainQuery.result<UnsignedLong>() / 1.0e6;
+        result.shadowStatistics = scene.shadowLight().statistics();
+        result.mainStatistics = scene.statistics();
+        result.drawn = scene.drawnCount();
+        result.occluded = scene.occludedCount();
+        result.allocations = allocations;
+        result.shadowScale = scene.shadowLight().resolutionScale();
+        if(shadowBudget > 0.0f) {
+            scene.shadowLight().setResolutionScale(shadowResolution.update(
+                Float(result.shadowGpuMs), std::size_t(i), std::size_t(i + 1)));
+        }
+        results.push_back(result);
+    }
+
+    Double cpuMs = 0.0, gpuMs = 0.0;
+    for(const FrameResult& result: results) {
+        cpuMs += result.cpuMs;
+        gpuMs += result.shadowGpuMs + result.mainGpuMs;
+    }
+
+    Debug() << results.size() << "frames, average CPU" << cpuMs / results.size()
+            << "ms, GPU" << gpuMs / results.size() << "ms";
+
+    if(!writeResults(_args.value("output"), results)) return 1;
+
+    return 0;
+}
+
+bool ShadowsBenchmark::writeResults(const std::string& filename,
+                                    const std::vector<FrameResult>& results) const {
+    std::ofstream out{ filename };
+    if(!out) {
+        Error() << "Can't write results to" << filename;
+        return false;
+    }
+
+    out << "{\n"
+        << "  \"size\": [" << _size.x() << ", " << _size.y() << "],\n"
+        << "  \"shadowMapSize\": " << _args.value<Int>("shadow-map-size") << ",\n"
+        << "  \"shadowMapLevels\": " << _args.value<Int>("shadow-map-levels") << ",\n"
+        << "  \"shadowMode\": \"" << _args.value("shadow-mode") << "\",\n"
+        << "  \"shadowBudget\": " << _args.value<Float>("shadow-budget") << ",\n"
+        << "  \"objects\": " << _args.value<std::size_t>("objects") << ",\n"
+        << "  \"seed\": " << _args.value<UnsignedLong>("seed") << ",\n"
+        << "  \"workerThreads\": " << _workerThreads << ",\n"
+        << "  \"gpuCulling\": " << (_args.isSet("gpu-culling") ? "true" : "false") << ",\n"
+        << "  \"occlusionCulling\": " << (_args.isSet("occlusion-culling") ? "true" : "false") << ",\n"
+        << "  \"lodBias\": " << _args.value<Float>("lod-bias") << ",\n"
+        << "  \"shadowLodBias\": " << _args.value<Float>("shadow-lod-bias") << ",\n"
+        << "  \"halfPositions\": " << (_args.isSet("half-positions") ? "true" : "false") << ",\n"
+        << "  \"meshCache\": " << (_args.value("mesh-cache").empty() ? "false" : "true") << ",\n"
+        << "  \"shaderCache\": " << (_args.value("shader-cache").empty() ? "false" : "true") << ",\n"
+        << "  \"loadMs\": " << _loadMs << ",\n"
+        << "  \"models\": [\n";
+
+    for(std::size_t i = 0; i != _meshStatistics.size(); ++i) {
+        const CompactMeshStatistics& mesh = _meshStatistics[i];
+        out << "    {\"vertices\": " << mesh.vertexCount
+            << ", \"indices\": " << mesh.indexCount
+            << ", \"originalVertexBytes\": " << mesh.originalVertexBytes()
+            << ", \"vertexBytes\": " << mesh.vertexBytes()
+            << ", \"originalDepthVertexSize\": " << mesh.originalDepthVertexSize
+            << ", \"depthVertexSize\": " << mesh.depthVertexSize
+            << ", \"originalAcmr\": " << mesh.originalAcmr
+            << ", \"acmr\": " << mesh.acmr
+            << (i + 1 == _meshStatistics.size() ? "}\n" : "},\n");
+    }
+
+    out << "  ],\n"
+        << "  \"frames\": [\n";
+
+    for(std::size_t i = 0; i != results.size(); ++i) {
+        const FrameResult& result = results[i];
+        out << "    {\"cpuMs\": " << result.cpuMs
+            << ", \"shadowGpuMs\": " << result.shadowGpuMs
+            << ", \"mainGpuMs\": " << result.mainGpuMs
+            << ", \"shadowScale\": " << result.shadowScale
+            << ", \"shadowDrawCalls\": " << result.shadowStatistics.drawCalls
+            << ", \"shadowTriangles\": " << result.shadowStatistics.triangles
+            << ", \"shadowBindChanges\": " << result.shadowStatistics.bindChanges
+            << ", \"shadowUnsortedBindChanges\": " << result.shadowStatistics.unsortedBindChanges
+            << ", \"mainDrawCalls\": " << result.mainStatistics.drawCalls
+            << ", \"mainTriangles\": " << result.mainStatistics.triangles
+            << ", \"mainBindChanges\": " << result.mainStatistics.bindChanges
+            << ", \"mainUnsortedBindChanges\": " << result.mainStatistics.unsortedBindChanges
+            << ", \"mainDrawn\": " << result.drawn
+            << ", \"mainOccluded\": " << result.occluded
+            << ", \"allocations\": " << result.allocations
+            << (i + 1 == results.size() ? "}\n" : "},\n");
+    }
+
+    out << "  ]\n}\n";
+    return true;
+}
+
+}}
+
+MAGNUM_WINDOWLESSAPPLICATION_MAIN(Magnum::Examples::ShadowsBenchmark)
@@ -1,47 +1,36 @@
-#include <Magnum/GL/Buffer.h>
+#include <cfloat>
+#include <Corrade/Containers/Pointer.h>
+#include <Corrade/Utility/Arguments.h>
 #include <Magnum/GL/DefaultFramebuffer.h>
+#include <Magnum/GL/Framebuffer.h>
 #include <Magnum/GL/Renderer.h>
 #include <Magnum/GL/Texture.h>
-#include <Magnum/MeshTools/Compile.h>
-#include <Magnum/MeshTools/CompressIndices.h>
+#include <Magnum/GL/TextureFormat.h>
 #include <Magnum/Platform/GlfwApplication.h>
-#include <Magnum/Primitives/Cube.h>
-#include <Magnum/Primitives/Capsule.h>
-#include <Magnum/Primitives/Plane.h>
-#include <Magnum/Shaders/Phong.h>
-#include <Magnum/SceneGraph/Scene.h>
 #include <Magnum/SceneGraph/Object.h>
-#include <Magnum/SceneGraph/AbstractObject.h>
-#include <Magnum/SceneGraph/Scene.h>
 #include <Magnum/SceneGraph/MatrixTransformation3D.h>
-#include <Magnum/Trade/MeshData.h>
 #include <Magnum/Math/Color.h>
 
 #include <Magnum/ImGuiIntegration/Context.hpp>
 #include <Magnum/ImGuiIntegration/Widgets.h>
 
-#include "ShadowReceiverShader.h"
-#include "ShadowLight.h"
-#include "ShadowReceiverDrawable.h"
+#include "FrameScheduler.h"
+#include "Profiler.h"
+#include "SceneLoader.h"
+#include "ShadowResolutionController.h"
+#include "ShadowsScene.h"
 #include "Types.h"
 
 namespace Magnum { namespace Examples {
 
-constexpr const float MainCameraNear = 0.01f;
-constexpr const float MainCameraFar = 100.0f;
-
-using namespace Math::Literals;
+/* Units per second, 0.3 per frame at 60 FPS */
+constexpr const Float CameraSpeed = 18.0f;
 
 class ShadowsExample: public Platform::Application {
     public:
         explicit ShadowsExample(const Arguments& arguments);
 
     private:
-        struct Model {
-            GL::Mesh mesh;
-            Float radius;
-        };
-
         void drawEvent() override;
         void mousePressEvent(MouseEvent& event) override;
         void mouseReleaseEvent(MouseEvent& event) override;
@@ -50,30 +39,40 @@ class ShadowsExample: public Platform::Application {
         void keyReleaseEvent(KeyEvent &event) override;
         void viewportEvent(ViewportEvent& event) override;
 
+        void invalidate();
         void step();
-        void addModel(const Trade::MeshData& meshData3D);
-        Object3D* createSceneObject(Model& model);
-        void recompileReceiverShader();
-        void setShadowMapSize(const Vector2i& shadowMapSize);
+        void updateCamera();
+        void setShadowMapSize(Int shadowMapSize);
+        void setShadowMapLevels(Int shadowMapLevels);
+        void setupShadowPreview();
+        void drawProfiler();
 
         ImGuiIntegration::Context _imgui{NoCreate};
 
-        Scene3D _scene;
-        SceneGraph::DrawableGroup3D _shadowReceiverDrawables;
-        ShadowReceiverShader _shadowReceiverShader{ NoCreate };
+        Containers::Pointer<ShadowsScene> _scene;
+        Containers::Pointer<SceneLoader> _loader;
+        Profiler _profiler;
+        FrameScheduler _scheduler;
 
-        Object3D _shadowLightObject;
-        Object3D _cameraObject;
-
-        ShadowLight _shadowLight;
-        SceneGraph::Camera3D _camera;
-
-        std::vector<Model> _models;
+        /* Used only if enabled, at the allocated size otherwise */
+        ShadowResolutionController _shadowResolution;
+        bool _adaptiveShadowResolution{};
 
+        /* Camera position after the last two fixed steps, drawn
+           interpolated between them */
         Vector3 _cameraVelocity;
-
-        Float _shadowBias { 0.003f };
-        Vector2i _shadowMapSize { 1024, 1024 };
+        Vector3 _cameraPosition, _previousCameraPosition;
+
+        /* The atlas is a depth texture with compare mode enabled for hard
+           shadows, which ImGui can't sample. The selected layer gets copied
+           here for preview. */
+        GL::Texture2D _shadowPreviewTexture{ NoCreate };
+        GL::Framebuffer _shadowPreviewFramebuffer{ NoCreate };
+        Int _shadowPreviewLayer { 0 };
+
+        /* The level count changed, its neighbours get compiled once the
+           frame showing it is out */
+        bool _shadersPending{};
 };
 
 ShadowsExample::ShadowsExample(const Arguments& arguments):
@@ -83,12 +82,24 @@ ShadowsExample::ShadowsExample(const Arguments& arguments):
             .setTitle("Magnum Shadows Example")
             // .setSize({ 1280, 720 }, { 1.5f, 1.5f })
             .setWindowFlags(Configuration::WindowFlag::Resizable),
-    },
-    _shadowLightObject{ &_scene },
-    _shadowLight{ _shadowLightObject },
-    _cameraObject{ &_scene },
-    _camera{ _cameraObject }
+    }
 {
+    Utility::Arguments args;
+    args.addOption("threads").setHelp("threads", "worker threads for culling, one less than hardware threads by default", "N")
+        .addOption("shadow-budget", "0").setHelp("shadow-budget", "shadow pass GPU time to adapt the shadow map resolution to, fixed resolution if zero", "MS")
+        .addOption("frame-cap", "0").setHelp("frame-cap", "most frames per second to draw, unlimited if zero", "FPS")
+        .addBooleanOption("no-vsync").setHelp("no-vsync", "don't wait for vertical sync")
+        .addSkippedPrefix("magnum", "engine-specific options")
+        .setGlobalHelp("Cascaded shadow maps of a randomly generated scene.");
+    SceneOptions::addArguments(args);
+    args.parse(arguments.argc, arguments.argv);
+
+    const Containers::Optional<SceneOptions> options = SceneOptions::fromArguments(args);
+    if(!options) {
+        exit(1);
+        return;
+    }
+
     _imgui = ImGuiIntegration::Context(Vector2{ windowSize() } / dpiScaling(),
                                        windowSize(),
                                        framebufferSize());
@@ -98,147 +109,136 @@ ShadowsExample::ShadowsExample(const Arguments& arguments):
     GL::Renderer::setBlendFunction(GL::Renderer::BlendFunction::SourceAlpha,
                                    GL::Renderer::BlendFunction::OneMinusSourceAlpha);
 
-    GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
-    GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
-
-    _shadowLight.setupShadowmaps(_shadowMapSize);
-    _shadowReceiverShader = ShadowReceiverShader{};
-    _shadowReceiverShader.setShadowBias(_shadowBias);
-
-    GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
-    GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
-
-    // Generate all 3d objects that are to be instanced
-    // into the scene.
-    addModel(Primitives::cubeSolid());
-    addModel(Primitives::capsule3DSolid(1, 1, 4, 1.0f));
-    addModel(Primitives::capsule3DSolid(6, 1, 9, 1.0f));
-
-    Object3D* ground = createSceneObject(_models[0]);
-    ground->setTransformation(Matrix4::scaling({100, 1, 100}));
-
-    for(std::size_t i = 0; i != 200; ++i) {
-        Model& model = _models[std::rand()%_models.size()];
-        Object3D* object = createSceneObject(model);
-        object->setTransformation(Matrix4::translation({
-            std::rand() * 100.0f / RAND_MAX - 50.0f,
-            std::rand() * 5.0f   / RAND_MAX,
-            std::rand() * 100.0f / RAND_MAX - 50.0f}));
+    /* The loader gets as many as the culling, it's done before the
+       scene is big enough to keep them busy */
+    const std::size_t workerThreads = args.value("threads").empty() ?
+        ThreadPool::defaultWorkerCount() : args.value<std::size_t>("threads");
+    _scene.reset(new ShadowsScene{ workerThreads, options->shaderCache });
+    if(!options->file.empty()) {
+        _loader.reset(new SceneLoader{ options->file, workerThreads, options->meshCache });
+    } else {
+        _scene->populate(*options);
+        for(const Model& model: _scene->models()) {
+            const CompactMeshStatistics& mesh = model.meshStatistics;
+            Debug() << "Model with" << mesh.vertexCount << "vertices:"
+                    << mesh.originalVertexBytes() << "->" << mesh.vertexBytes()
+                    << "vertex bytes, depth pass fetching" << mesh.originalDepthVertexSize
+                    << "->" << mesh.depthVertexSize << "bytes per vertex, ACMR"
+                    << mesh.originalAcmr << "->" << mesh.acmr;
+        }
     }
+    _scene->setViewport(GL::defaultFramebuffer.viewport().size());
 
-    _camera.setProjectionMatrix(
-        Matrix4::perspectiveProjection(
-            35.0_degf,
-            Vector2{ GL::defaultFramebuffer.viewport().size() }.aspectRatio(),
-            MainCameraNear,
-            MainCameraFar
-        )
-    );
-
-    _cameraObject.setTransformation(Matrix4::translation(Vector3::yAxis(3.0f)));
-
-    _shadowLightObject.setTransformation(
-        Matrix4::lookAt(
-            { 3.0f, 1.0f, 2.0f },
-            {},
-            Vector3::yAxis()
-        )
-    );
-}
+    /* Everything the settings can switch to without waiting */
+    _scene->precompileShaders();
 
-/**
- * @brief Generate geometry for later compilation into meshes
- *
- * These aren't actually drawn, but rather copied
- * and transformed by `createSceneObject`
- *
- */
-void ShadowsExample::addModel(const Trade::MeshData& meshData) {
-    _models.emplace_back();
-    Model& model = _models.back();
+    _cameraPosition = _previousCameraPosition =
+        _scene->cameraObject().transformation().translation();
 
-    // Compute bounding sphere of model
-    Float maxMagnitudeSquared = 0.0f;
-    for(Vector3 position: meshData.positions3DAsArray()) {
-        Float magnitudeSquared = position.dot();
+    setSwapInterval(args.isSet("no-vsync") ? 0 : 1);
+    _scheduler.setFrameCap(args.value<Float>("frame-cap"));
 
-        if(magnitudeSquared > maxMagnitudeSquared) {
-            maxMagnitudeSquared = magnitudeSquared;
-        }
+    if(args.value<Float>("shadow-budget") > 0.0f) {
+        _shadowResolution.setBudget(args.value<Float>("shadow-budget"));
+        _adaptiveShadowResolution = true;
     }
 
-    model.radius = std::sqrt(maxMagnitudeSquared);
-    model.mesh = MeshTools::compile(MeshTools::compressIndices(meshData));
+    setupShadowPreview();
 }
 
-/**
- * @brief Add a caster and/or reciever object to the scene
- *
- * Notice in particular that each "Model" is instantiated twice
- * most of the time. On rare occasions would you need something
- * to receive but not cast (e.g. ground?) and cast but not receive
- * (e.g. light?)
- *
- * Also notice the `radius` attribute. This is what must be used
- * for culling.
- *
- */
-Object3D* ShadowsExample::createSceneObject(Model& model) {
-    auto* object = new Object3D(&_scene);
-
-    auto receiver = new ShadowReceiverDrawable(*object, &_shadowReceiverDrawables);
-    receiver->setShader(_shadowReceiverShader);
-    receiver->setMesh(model.mesh);
- 
-    return object;
+void ShadowsExample::invalidate() {
+    _scheduler.invalidate();
+    redraw();
 }
 
+/* One fixed step, the same distance no matter the frame rate */
 void ShadowsExample::step() {
+    _previousCameraPosition = _cameraPosition;
     if(!_cameraVelocity.isZero()) {
-        Matrix4 transform = _cameraObject.transformation();
-        transform.translation() += transform.rotation()
-                                   * _cameraVelocity
-                                   * 0.3f;
-        _cameraObject.setTransformation(transform);
+        _cameraPosition += _scene->cameraObject().transformation().rotation()
+                           * _cameraVelocity
+                           * CameraSpeed*_scheduler.timestep();
     }
 }
 
+/* Mouse look changes only the rotation, which is kept */
+void ShadowsExample::updateCamera() {
+    Object3D& cameraObject = _scene->cameraObject();
+    Matrix4 transform = cameraObject.transformation();
+    transform.translation() = Math::lerp(_previousCameraPosition, _cameraPosition,
+                                         _scheduler.interpolation());
+    cameraObject.setTransformation(transform);
+}
+
 void ShadowsExample::drawEvent() {
-    this->step();
+    for(UnsignedInt steps = _scheduler.beginFrame(); steps; --steps) step();
+    updateCamera();
+
+    /* Leaves most of a 60 FPS frame for drawing */
+    if(_loader && !_loader->upload(*_scene, std::chrono::milliseconds{ 4 })) {
+        _loader = nullptr;
+    }
 
+    _profiler.beginFrame();
     _imgui.newFrame();
 
-    _shadowLight.setTarget({ 3, 2, 3 }, Vector3::zAxis(), _camera);
+    /* The measurement is a few frames old, which the controller expects.
+       Carried-over ones were already counted. */
+    if(_adaptiveShadowResolution && _profiler.isGpuTimeNew(Profiler::Pass::Shadow)) {
+        _scene->shadowLight().setResolutionScale(_shadowResolution.update(
+            _profiler.gpuTime(Profiler::Pass::Shadow),
+            _profiler.gpuTimeFrame(Profiler::Pass::Shadow),
+            _profiler.frame()));
+    }
 
     /* Create the shadow map textures. */
-    GL::Renderer::setFaceCullingMode(GL::Renderer::PolygonFacing::Front);
-    {
-        _shadowLight.render(_shadowReceiverDrawables);
-    }
-    GL::Renderer::setFaceCullingMode(GL::Renderer::PolygonFacing::Back);
+    _profiler.beginPass(Profiler::Pass::Shadow);
+    _scene->drawShadows();
+    _profiler.endPass(Profiler::Pass::Shadow);
+
+    ShadowLight& shadowLight = _scene->shadowLight();
 
     ImVec2 windowSize { 200, 200 };
     ImGui::SetNextWindowSize(windowSize, ImGuiCond_FirstUseEver);
     ImGui::Begin("Shadowmap");
     {
+        ImGui::SliderInt("Layer", &_shadowPreviewLayer, 0, _scene->shadowMapLevels() - 1);
+        ImGui::Text("Split at %.2f", Double(shadowLight.cutDistance(
+            MainCameraNear, MainCameraFar, _shadowPreviewLayer)));
+
+        Float splitLambda = _scene->shadowSplitLambda();
+        if(ImGui::SliderFloat("Split lambda", &splitLambda, 0.0f, 1.0f)) {
+            _scene->setShadowSplitLambda(splitLambda);
+        }
+
+        ShadowAtlas& atlas = _scene->shadowAtlas();
+        ImGui::Text("Atlas %dx%d, %.0f%% used", atlas.size(), atlas.size(),
+                    Double(atlas.usage() * 100.0f));
+
+        GL::AbstractFramebuffer::blit(
+            atlas.framebuffer(),
+            _shadowPreviewFramebuffer,
+            shadowLight.layerViewport(_shadowPreviewLayer),
+            { {}, Vector2i{ _scene->shadowMapSize() } },
+            GL::FramebufferBlit::Depth,
+            GL::FramebufferBlitFilter::Nearest
+        );
+
         Float width { ImGui::GetWindowWidth() };
         ImGuiIntegration::image(
-            _shadowLight.shadowTexture(),
-            Vector2(width, width * _shadowLight.size().aspectRatio()),
+            _shadowPreviewTexture,
+            Vector2{ width },
             {{}, Vector2{ 1.0f }}                            // uvRange
         );
     }
     ImGui::End();
 
-    /* Render the scene */
-    GL::Renderer::setClearColor({0.1f, 0.1f, 0.4f, 1.0f});
-    GL::defaultFramebuffer.clear(GL::FramebufferClear::Color | GL::FramebufferClear::Depth);
-
-    _shadowReceiverShader.setShadowmapMatrix(_shadowLight.layerMatrix())
-                         .setShadowmapTexture(_shadowLight.shadowTexture())
-                         .setLightDirection(_shadowLightObject.transformation().backward());
+    drawProfiler();
 
-    _camera.draw(_shadowReceiverDrawables);
+    /* Render the scene */
+    _profiler.beginPass(Profiler::Pass::Main);
+    _scene->draw(GL::defaultFramebuffer);
+    _profiler.endPass(Profiler::Pass::Main);
 
     if (ImGui::GetIO().WantTextInput && !this->isTextInputActive()) {
         startTextInput();
@@ -254,7 +254,9 @@ void ShadowsExample::drawEvent() {
     GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
     GL::Renderer::disable(GL::Renderer::Feature::DepthTest);
 
+    _profiler.beginPass(Profiler::Pass::ImGui);
     _imgui.drawFrame();
+    _profiler.endPass(Profiler::Pass::ImGui);
 
     GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
     GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
@@ -262,10 +264,155 @@ void ShadowsExample::drawEvent() {
     GL::Renderer::disable(GL::Renderer::Feature::Blending);
 
     swapBuffers();
-    redraw();
+
+    if(_shadersPending) {
+        _scene->precompileShaders();
+        _shadersPending = false;
+    }
+
+    /* Otherwise the next frame is drawn only after an event */
+    const bool animating = !_cameraVelocity.isZero() ||
+        _cameraPosition != _previousCameraPosition || _loader;
+    if(_scheduler.endFrame(animating)) redraw();
+}
+
+/**
+ * @brief Timings, counters and the settings that affect them most
+ *
+ * Times shown are of previous frames, the current one is still being
+ * recorded.
+ *
+ */
+void ShadowsExample::drawProfiler() {
+    ShadowLight& shadowLight = _scene->shadowLight();
+
+    ImGui::Begin("Profiler");
+    {
+        if(_loader) {
+            ImGui::Text("Loading: %zu of %zu meshes", _loader->finishedCount(),
+                        _loader->meshCount());
+            ImGui::Separator();
+        }
+
+        const ShaderVariants& shaders = _scene->shaderVariants();
+        ImGui::Text("Shader variants: %zu, %zu loaded from disk", shaders.variantCount(),
+                    shaders.binaryCache().loadedCount());
+
+        const struct {
+            Profiler::Pass pass;
+            const char* name;
+        } passes[]{
+            { Profiler::Pass::Shadow, "Shadow" },
+            { Profiler::Pass::Main, "Main" },
+            { Profiler::Pass::ImGui, "ImGui" }
+        };
+
+        for(const auto& pass: passes) {
+            const Containers::ArrayView<const Float> cpu = _profiler.cpuHistory(pass.pass);
+            const Containers::ArrayView<const Float> gpu = _profiler.gpuHistory(pass.pass);
+            const Int offset = Int(_profiler.historyOffset());
+
+            ImGui::Text("%s pass: CPU %.2f ms, GPU %.2f ms", pass.name,
+                        Double(_profiler.cpuTime(pass.pass)),
+                        Double(_profiler.gpuTime(pass.pass)));
+            ImGui::PushID(pass.name);
+            ImGui::PlotLines("CPU", cpu.data(), Int(cpu.size()), offset,
+                             nullptr, 0.0f, FLT_MAX, ImVec2{ 0, 40 });
+            ImGui::PlotLines("GPU", gpu.data(), Int(gpu.size()), offset,
+                             nullptr, 0.0f, FLT_MAX, ImVec2{ 0, 40 });
+            ImGui::PopID();
+        }
+
+        ImGui::Separator();
+
+        const DrawStatistics& main = _scene->statistics();
+        const DrawStatistics& shadow = shadowLight.statistics();
+        ImGui::Text("Main pass: %zu draw calls, %zu triangles",
+                    main.drawCalls, main.triangles);
+        ImGui::Text("    %zu drawn, %zu culled, %zu of them occluded",
+                    _scene->drawnCount(), _scene->culledCount(),
+                    _scene->occludedCount());
+        ImGui::Text("    %zu binds, %zu unsorted",
+                    main.bindChanges, main.unsortedBindChanges);
+        ImGui::Text("Shadow pass: %zu draw calls, %zu triangles",
+                    shadow.drawCalls, shadow.triangles);
+        ImGui::Text("    %zu drawn, %zu culled",
+                    shadowLight.drawnCount(), shadowLight.culledCount());
+        ImGui::Text("    %zu binds, %zu unsorted",
+                    shadow.bindChanges, shadow.unsortedBindChanges);
+
+        ImGui::Separator();
+
+        ImGui::Text("Shadow maps: %d, nearest %dx%d",
+                    _scene->shadowMapLevels(),
+                    _scene->shadowMapSize(), _scene->shadowMapSize());
+        ImGui::SameLine();
+        if(ImGui::SmallButton("-")) setShadowMapSize(_scene->shadowMapSize() / 2);
+        ImGui::SameLine();
+        if(ImGui::SmallButton("+")) setShadowMapSize(_scene->shadowMapSize() * 2);
+
+        if(ImGui::Checkbox("Adaptive resolution", &_adaptiveShadowResolution) &&
+           !_adaptiveShadowResolution) {
+            /* Starts again from the full resolution it's now rendered at */
+            shadowLight.setResolutionScale(1.0f);
+            _shadowResolution = ShadowResolutionController{ _shadowResolution.budget() };
+        }
+        if(_adaptiveShadowResolution) {
+            Float budget = _shadowResolution.budget();
+            if(ImGui::SliderFloat("Shadow budget", &budget, 0.1f, 10.0f, "%.1f ms")) {
+                _shadowResolution.setBudget(budget);
+            }
+            ImGui::Text("Rendered at %dx%d", shadowLight.viewportSize(),
+                        shadowLight.viewportSize());
+        }
+
+        ImGui::Text("Shadow memory: %.1f MB atlas, %.1f MB moments, %.1f MB cache",
+                    Double(_scene->shadowAtlas().memoryUsage()) / (1024.0 * 1024.0),
+                    Double(shadowLight.momentsMemoryUsage()) / (1024.0 * 1024.0),
+                    Double(shadowLight.cacheMemoryUsage()) / (1024.0 * 1024.0));
+
+        Int shadowMode = Int(_scene->shadowMode());
+        if(ImGui::Combo("Shadow mode", &shadowMode, "Hard\0Variance\0")) {
+            _scene->setShadowMode(ShadowMode(shadowMode));
+        }
+
+        Float shadowBias = _scene->shadowBias();
+        if(ImGui::DragFloat("Shadow bias", &shadowBias, 0.0001f, 0.0f, 0.1f, "%.4f")) {
+            _scene->setShadowBias(shadowBias);
+        }
+
+        Float lodBias = _scene->lodBias();
+        if(ImGui::SliderFloat("LOD bias", &lodBias, 0.1f, 2.0f)) {
+            _scene->setLodBias(lodBias);
+        }
+
+        Float shadowLodBias = _scene->shadowLodBias();
+        if(ImGui::SliderFloat("Shadow LOD bias", &shadowLodBias, 0.1f, 2.0f)) {
+            _scene->setShadowLodBias(shadowLodBias);
+        }
+
+        bool gpuCullingEnabled = _scene->isGpuCullingEnabled();
+        if(ImGui::Checkbox("GPU culling", &gpuCullingEnabled)) {
+            _scene->setGpuCullingEnabled(gpuCullingEnabled);
+        }
+
+        bool occlusionCullingEnabled = _scene->isOcclusionCullingEnabled();
+        if(ImGui::Checkbox("Occlusion culling", &occlusionCullingEnabled)) {
+            _scene->setOcclusionCullingEnabled(occlusionCullingEnabled);
+        }
+
+        bool cachingEnabled = shadowLight.isCachingEnabled();
+        if(ImGui::Checkbox("Cache static casters", &cachingEnabled)) {
+            shadowLight.setCachingEnabled(cachingEnabled);
+        }
+        ImGui::Text("Cached layers: %zu of %zu",
+                    shadowLight.cachedLayerCount(), shadowLight.layerCount());
+    }
+    ImGui::End();
 }
 
 void ShadowsExample::mousePressEvent(MouseEvent& event) {
+    invalidate();
     if(_imgui.handleMousePressEvent(event)) return;
 
     if(event.button() != MouseEvent::Button::Left) return;
@@ -273,33 +420,34 @@ void ShadowsExample::mousePressEvent(MouseEvent& event) {
 }
 
 void ShadowsExample::mouseReleaseEvent(MouseEvent& event) {
+    invalidate();
     if(_imgui.handleMouseReleaseEvent(event)) return;
 
     event.setAccepted();
-    redraw();
 }
 
 void ShadowsExample::mouseMoveEvent(MouseMoveEvent& event) {
+    invalidate();
     if(_imgui.handleMouseMoveEvent(event)) return;
 
     if(!(event.buttons() & MouseMoveEvent::Button::Left)) return;
 
-    const Matrix4 transform = _cameraObject.transformation();
+    const Matrix4 transform = _scene->cameraObject().transformation();
 
     constexpr const Float angleScale = 0.0005f;
     const Float angleX = event.relativePosition().x() * angleScale;
     const Float angleY = event.relativePosition().y() * angleScale;
     if(angleX != 0.0f || angleY != 0.0f) {
-        _cameraObject.setTransformation(Matrix4::lookAt(transform.translation(),
+        _scene->cameraObject().setTransformation(Matrix4::lookAt(transform.translation(),
             transform.translation() - transform.rotationScaling()*Vector3{-angleX, angleY, 1.0f},
             Vector3::yAxis()));
     }
 
     event.setAccepted();
-    redraw();
 }
 
 void ShadowsExample::keyPressEvent(KeyEvent& event) {
+    invalidate();
     if(_imgui.handleKeyPressEvent(event)) return;
 
     if(event.key() == KeyEvent::Key::Esc) {
@@ -324,26 +472,32 @@ void ShadowsExample::keyPressEvent(KeyEvent& event) {
         _cameraVelocity.x() = -1.0f;
 
     } else if(event.key() == KeyEvent::Key::F7) {
-        _shadowReceiverShader.setShadowBias(_shadowBias /= 1.125f);
-        Debug() << "Shadow bias" << _shadowBias;
+        _scene->setShadowBias(_scene->shadowBias()/1.125f);
+        Debug() << "Shadow bias" << _scene->shadowBias();
 
     } else if(event.key() == KeyEvent::Key::F8) {
-        _shadowReceiverShader.setShadowBias(_shadowBias *= 1.125f);
-        Debug() << "Shadow bias" << _shadowBias;
+        _scene->setShadowBias(_scene->shadowBias()*1.125f);
+        Debug() << "Shadow bias" << _scene->shadowBias();
+
+    } else if(event.key() == KeyEvent::Key::F9) {
+        setShadowMapLevels(_scene->shadowMapLevels() - 1);
+
+    } else if(event.key() == KeyEvent::Key::F10) {
+        setShadowMapLevels(_scene->shadowMapLevels() + 1);
 
     } else if(event.key() == KeyEvent::Key::F11) {
-        setShadowMapSize(_shadowMapSize / 2);
+        setShadowMapSize(_scene->shadowMapSize() / 2);
 
     } else if(event.key() == KeyEvent::Key::F12) {
-        setShadowMapSize(_shadowMapSize * 2);
+        setShadowMapSize(_scene->shadowMapSize() * 2);
 
     } else return;
 
     event.setAccepted();
-    redraw();
 }
 
 void ShadowsExample::keyReleaseEvent(KeyEvent &event) {
+    invalidate();
     if(_imgui.handleKeyReleaseEvent(event)) return;
 
     if(event.key() == KeyEvent::Key::Up || event.key() == KeyEvent::Key::Down) {
@@ -358,34 +512,44 @@ void ShadowsExample::keyReleaseEvent(KeyEvent &event) {
     } else return;
 
     event.setAccepted();
-    redraw();
 }
 
-void ShadowsExample::setShadowMapSize(const Vector2i& shadowMapSize) {
-    if((shadowMapSize >= Vector2i{1}).all() && (shadowMapSize <= GL::Texture2D::maxSize()).all()) {
-        _shadowMapSize = shadowMapSize;
-        _shadowLight.setupShadowmaps(_shadowMapSize);
-        Debug() << "Shadow map size" << shadowMapSize << "x";
+void ShadowsExample::setShadowMapSize(const Int shadowMapSize) {
+    if(shadowMapSize >= 1 && _scene->setupShadowmaps(_scene->shadowMapLevels(), shadowMapSize)) {
+        setupShadowPreview();
+        Debug() << "Shadow map size" << _scene->shadowMapSize() << "x" << _scene->shadowMapLevels();
     }
 }
 
-void ShadowsExample::recompileReceiverShader() {
-    _shadowReceiverShader = ShadowReceiverShader{};
-    _shadowReceiverShader.setShadowBias(_shadowBias);
-    for(std::size_t i = 0; i != _shadowReceiverDrawables.size(); ++i) {
-        auto& drawable = static_cast<ShadowReceiverDrawable&>(_shadowReceiverDrawables[i]);
-        drawable.setShader(_shadowReceiverShader);
+void ShadowsExample::setShadowMapLevels(const Int shadowMapLevels) {
+    if(shadowMapLevels >= 1 && _scene->setupShadowmaps(shadowMapLevels, _scene->shadowMapSize())) {
+        _shadowPreviewLayer = Math::min(_shadowPreviewLayer, _scene->shadowMapLevels() - 1);
+        _shadersPending = true;
+        Debug() << "Shadow map levels" << _scene->shadowMapLevels();
     }
 }
 
+void ShadowsExample::setupShadowPreview() {
+    const Vector2i size{ _scene->shadowMapSize() };
+    _shadowPreviewTexture = GL::Texture2D{};
+    _shadowPreviewTexture.setStorage(1, GL::TextureFormat::DepthComponent24, size);
+
+    _shadowPreviewFramebuffer = GL::Framebuffer{ { {}, size } };
+    _shadowPreviewFramebuffer
+        .attachTexture(GL::Framebuffer::BufferAttachment::Depth,
+                       _shadowPreviewTexture, 0)
+        .mapForDraw(GL::Framebuffer::DrawAttachment::None);
+}
+
 void ShadowsExample::viewportEvent(ViewportEvent& event) {
     GL::defaultFramebuffer.setViewport({{}, event.framebufferSize()});
+    _scene->setViewport(event.framebufferSize());
 
     _imgui.relayout(Vector2{ event.windowSize() } / event.dpiScaling(),
         event.windowSize(), event.framebufferSize());
+    invalidate();
 }
 
-
 }}
 
 MAGNUM_APPLICATION_MAIN(Magnum::Examples::ShadowsExample)
@@ -0,0 +1,560 @@
+#include "ShadowsScene.h"
+
+#include <Corrade/Containers/ArrayViewStl.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Primitives/Capsule.h>
+#include <Magnum/Primitives/Cube.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "MeshCache.h"
+#include "ShadowCasterDrawable.h"
+#include "ShadowReceiverDrawable.h"
+
+namespace Magnum { namespace Examples {
+
+using namespace Math::Literals;
+
+namespace {
+
+/* SplitMix64. Much faster than std::rand() and, unlike it, gives the same
+   sequence everywhere. */
+class Random {
+    public:
+        explicit Random(UnsignedLong seed): _state{seed} {}
+
+        UnsignedLong next() {
+            UnsignedLong z = (_state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        /* In [0, 1), from the top 24 bits */
+        Float nextFloat() { return Float(next() >> 40)/16777216.0f; }
+
+    private:
+        UnsignedLong _state;
+};
+
+/* Relative margin a LOD has to be passed by before switching back to a
+   finer one */
+constexpr Float LodHysteresis = 0.2f;
+
+/* Entries one pool iteration picks the LODs for */
+constexpr std::size_t LodBatchSize = 1024;
+
+}
+
+void SceneOptions::addArguments(Utility::Arguments& arguments) {
+    arguments
+        .addOption("objects", "200").setHelp("objects", "number of objects besides the ground", "N")
+        .addOption("seed", "1").setHelp("seed", "random seed", "N")
+        .addOption("area", "100").setHelp("area", "width and depth of the area the objects are placed in", "SIZE")
+        .addOption("height", "0 5").setHelp("height", "range of object heights above the ground", "\"MIN MAX\"")
+        .addOption("height-distribution", "uniform").setHelp("height-distribution", "uniform, or ground to put most objects close to the min height", "NAME")
+        .addOption("model-mix", "1 1 1").setHelp("model-mix", "relative frequency of cubes, low- and high-poly capsules", "\"CUBE LOW HIGH\"")
+        .addOption("dynamic-ratio", "0").setHelp("dynamic-ratio", "fraction of objects whose shadows aren't cached", "RATIO")
+        .addBooleanOption("half-positions").setHelp("half-positions", "store vertex positions as half-floats")
+        .addBooleanOption("no-lods").setHelp("no-lods", "draw all objects at full detail")
+        .addOption("scene").setHelp("scene", "OBJ or glTF file to load instead of generating the scene", "FILE")
+        .addOption("mesh-cache").setHelp("mesh-cache", "file to keep preprocessed meshes in between runs", "FILE")
+        .addOption("shader-cache").setHelp("shader-cache", "directory to keep linked shader programs in between runs", "DIR");
+}
+
+Containers::Optional<SceneOptions> SceneOptions::fromArguments(const Utility::Arguments& arguments) {
+    SceneOptions options;
+    options.objectCount = arguments.value<std::size_t>("objects");
+    options.seed = arguments.value<UnsignedLong>("seed");
+    options.area = arguments.value<Float>("area");
+    options.height = arguments.value<Vector2>("height");
+    options.modelMix = arguments.value<Vector3>("model-mix");
+    options.dynamicRatio = arguments.value<Float>("dynamic-ratio");
+    options.halfPositions = arguments.isSet("half-positions");
+    options.lods = !arguments.isSet("no-lods");
+    options.file = arguments.value("scene");
+    options.meshCache = arguments.value("mesh-cache");
+    options.shaderCache = arguments.value("shader-cache");
+
+    if((options.modelMix < Vector3{ 0.0f }).any() || options.modelMix.sum() <= 0.0f) {
+        Error() << "Model mix weights can't be negative and need a positive sum, got"
+                << options.modelMix;
+        return {};
+    }
+
+    const std::string distribution = arguments.value("height-distribution");
+    if(distribution == "ground") {
+        options.heightDistribution = HeightDistribution::Ground;
+    } else if(distribution != "uniform") {
+        Warning() << "Unknown height distribution" << distribution << Debug::nospace << ", using uniform";
+    }
+
+    return options;
+}
+
+ShadowsScene::ShadowsScene(const std::size_t workerThreads,
+                           const std::string& shaderCache):
+    _threadPool{ workerThreads },
+    _shaders{ shaderCache },
+    _shadowLightObject{ &_scene },
+    _cameraObject{ &_scene },
+    _shadowLight{ _shadowLightObject },
+    _camera{ _cameraObject }
+{
+    GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
+    GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+
+    CORRADE_INTERNAL_ASSERT_OUTPUT(setupShadowmaps(_shadowMapLevels, _shadowMapSize));
+    _shadowCasterShader = &_shaders.caster();
+    _shadowReceiverShader = &_shaders.receiver(_shadowMapLevels, _shadowMode);
+
+    /* The frame block, the receiver pass and at most two caster passes for
+       every layer */
+    _uniforms = UniformRing{ 2*MaxShadowMapLevels + 2, sizeof(FrameUniforms) };
+
+    /* Empty buffers until occlusion culling gets enabled */
+    _occlusionCuller = OcclusionCuller{};
+
+    _cameraObject.setTransformation(Matrix4::translation(Vector3::yAxis(3.0f)));
+
+    _shadowLightObject.setTransformation(
+        Matrix4::lookAt(
+            { 3.0f, 1.0f, 2.0f },
+            {},
+            Vector3::yAxis()
+        )
+    );
+}
+
+/**
+ * These aren't actually drawn, but rather copied
+ * and transformed by `createSceneObject`
+ *
+ */
+Model& ShadowsScene::addModel(const Trade::MeshData& meshData,
+                              const bool halfPositions) {
+    return addModel(compactMesh(meshData, halfPositions));
+}
+
+Model& ShadowsScene::addModel(const CompactMeshView& data) {
+    /* Drawables point to their models, which growing the array would
+       move */
+    CORRADE_INTERNAL_ASSERT(_models.size() < _models.capacity() ||
+        !(_staticCasterIndex.size() + _dynamicCasterIndex.size() + _receiverIndex.size()));
+
+    _models.emplace_back();
+    Model& model = _models.back();
+    model.radius = data.radius;
+    model.meshStatistics = data.statistics;
+    model.setMesh(compileCompactMesh(data));
+    _gpuCulling.addMesh(data);
+    return model;
+}
+
+void ShadowsScene::reserveModels(const std::size_t count) {
+    CORRADE_INTERNAL_ASSERT(_models.size() + count <= _models.capacity() ||
+        !(_staticCasterIndex.size() + _dynamicCasterIndex.size() + _receiverIndex.size()));
+    _models.reserve(_models.size() + count);
+}
+
+void ShadowsScene::addLod(const std::size_t model,
+                          const Trade::MeshData& meshData,
+                          const Float maxScreenSize,
+                          const bool halfPositions) {
+    addLod(model, compactMesh(meshData, halfPositions), maxScreenSize);
+}
+
+void ShadowsScene::addLod(const std::size_t model,
+                          const CompactMeshView& data,
+                          const Float maxScreenSize) {
+    CORRADE_INTERNAL_ASSERT(_models[model].lods.empty() ||
+        _models[model].lods.back().maxScreenSize > maxScreenSize);
+
+    const std::size_t lod = _models.size();
+    addModel(data);
+    _models[model].lods.push_back({ lod, maxScreenSize });
+}
+
+/**
+ * Notice in particular that each "Model" is instantiated twice
+ * most of the time. On rare occasions would you need something
+ * to receive but not cast (e.g. ground?) and cast but not receive
+ * (e.g. light?)
+ *
+ * Also notice the `radius` attribute. This is what must be used
+ * for culling.
+ *
+ * Casters that are going to move should be marked as dynamic, the
+ * shadow depth of static ones is cached and only redrawn when one of
+ * them changes its transformation.
+ *
+ */
+Object3D* ShadowsScene::createSceneObject(Model& model,
+                                          const bool makeCaster,
+                                          const bool makeReceiver,
+                                          const bool isDynamic) {
+    auto* object = new Object3D(&_scene);
+    const UnsignedInt modelId = UnsignedInt(&model - _models.data());
+    ++model.objectCount;
+    for(const Model::Lod& lod: model.lods) ++_models[lod.model].objectCount;
+
+    if(makeCaster) {
+        auto caster = new ShadowCasterDrawable(*object, nullptr);
+        caster->setModel(model);
+        (isDynamic ? _dynamicCasterIndex : _staticCasterIndex).add(*caster, model.radius, modelId);
+    }
+
+    if(makeReceiver) {
+        auto receiver = new ShadowReceiverDrawable(*object, nullptr);
+        receiver->setModel(model);
+        _receiverIndex.add(*receiver, model.radius, modelId);
+        if(!makeCaster) _receiverOnlyObjects.push_back(object);
+    }
+
+    return object;
+}
+
+void ShadowsScene::populate(const SceneOptions& options) {
+    // Generate all 3d objects that are to be instanced
+    // into the scene.
+    {
+        MeshCache cache{ options.meshCache };
+        const bool half = options.halfPositions;
+        addModel(cache.get(Primitives::cubeSolid(), half));
+        addModel(cache.get(Primitives::capsule3DSolid(1, 1, 4, 1.0f), half));
+        addModel(cache.get(Primitives::capsule3DSolid(6, 1, 9, 1.0f), half));
+
+        /* Added after all base models so the indices above stay */
+        if(options.lods) {
+            addLod(1, cache.get(Primitives::capsule3DSolid(1, 1, 3, 1.0f), half), 0.1f);
+            addLod(2, cache.get(Primitives::capsule3DSolid(3, 1, 6, 1.0f), half), 0.25f);
+            addLod(2, cache.get(Primitives::capsule3DSolid(1, 1, 4, 1.0f), half), 0.1f);
+        }
+
+        /* Everything's uploaded, the views aren't needed anymore */
+        cache.save();
+    }
+
+    /* Nothing is below the ground, so there's no point in it casting */
+    Object3D* ground = createSceneObject(_models[0], false, true);
+    ground->setTransformation(Matrix4::scaling({options.area, 1.0f, options.area}));
+
+    /* Model picked by where a random number falls in the cumulative
+       weights */
+    const Vector3 mix = options.modelMix;
+    const Float mixSum = mix.sum();
+    CORRADE_INTERNAL_ASSERT(mixSum > 0.0f);
+    const Float cumulative[]{ mix[0]/mixSum, (mix[0] + mix[1])/mixSum };
+
+    Random random{ options.seed };
+    for(std::size_t i = 0; i != options.objectCount; ++i) {
+        const Float modelPick = random.nextFloat();
+        const std::size_t modelIndex = modelPick < cumulative[0] ? 0 :
+                                       modelPick < cumulative[1] ? 1 : 2;
+        Model& model = _models[modelIndex];
+
+        const bool isDynamic = random.nextFloat() < options.dynamicRatio;
+        const Float x = (random.nextFloat() - 0.5f)*options.area;
+        const Float z = (random.nextFloat() - 0.5f)*options.area;
+        Float t = random.nextFloat();
+        if(options.heightDistribution == SceneOptions::HeightDistribution::Ground) {
+            t *= t*t;
+        }
+
+        Object3D* object = createSceneObject(model, true, true, isDynamic);
+        object->setTransformation(Matrix4::translation({
+            x, Math::lerp(options.height.x(), options.height.y(), t), z}));
+    }
+}
+
+void ShadowsScene::setViewport(const Vector2i& size) {
+    _camera.setViewport(size);
+    _camera.setProjectionMatrix(
+        Matrix4::perspectiveProjection(
+            35.0_degf,
+            Vector2{ size }.aspectRatio(),
+            MainCameraNear,
+            MainCameraFar
+        )
+    );
+}
+
+bool ShadowsScene::setupShadowmaps(const Int shadowMapLevels,
+                                   const Int shadowMapSize) {
+    if(shadowMapLevels > MaxShadowMapLevels) {
+        Warning() << "At most" << MaxShadowMapLevels << "shadow map levels are supported";
+        return false;
+    }
+
+    /* The atlas is only as large as the tiles of all layers need */
+    Int tileSizes[MaxShadowMapLevels];
+    for(Int i = 0; i != shadowMapLevels; ++i) {
+        tileSizes[i] = ShadowLight::layerTileSize(i, shadowMapSize);
+    }
+    const Int atlasSize = ShadowAtlas::fittingSize(
+        Containers::arrayView(tileSizes, std::size_t(shadowMapLevels)));
+    if(atlasSize > _maxShadowAtlasSize) {
+        Warning() << "No room in a" << _maxShadowAtlasSize << "shadow atlas for"
+                  << shadowMapLevels << "maps of size" << shadowMapSize;
+        return false;
+    }
+
+    /* The light gives its tiles back to the atlas they came from, so it has
+       to do that before the atlas gets replaced */
+    if(atlasSize != _shadowAtlas.size()) {
+        _shadowLight.releaseShadowmaps();
+        _shadowAtlas = ShadowAtlas{ atlasSize };
+    }
+    CORRADE_INTERNAL_ASSERT_OUTPUT(
+        _shadowLight.setupShadowmaps(_shadowAtlas, shadowMapLevels, shadowMapSize));
+
+    /* Sizes get rounded to a power of two */
+    const bool levelsChanged = shadowMapLevels != _shadowMapLevels;
+    _shadowMapLevels = shadowMapLevels;
+    _shadowMapSize = _shadowLight.size();
+    _shadowLight.setupSplitDistances(MainCameraNear, MainCameraFar, _shadowSplitLambda);
+
+    if(levelsChanged) {
+        _shadowReceiverShader = &_shaders.receiver(_shadowMapLevels, _shadowMode);
+        if(_gpuCullingEnabled) setupGpuCullingViews();
+    }
+
+    return true;
+}
+
+void ShadowsScene::setShadowBias(const Float bias) {
+    _shadowBias = bias;
+}
+
+void ShadowsScene::setShadowMode(const ShadowMode mode) {
+    if(mode == _shadowMode) return;
+
+    _shadowMode = mode;
+    _shadowLight.setShadowMode(_shadowMode);
+    _shadowReceiverShader = &_shaders.receiver(_shadowMapLevels, _shadowMode);
+}
+
+void ShadowsScene::setShadowSplitLambda(const Float lambda) {
+    _shadowSplitLambda = lambda;
+    _shadowLight.setupSplitDistances(MainCameraNear, MainCameraFar, _shadowSplitLambda);
+}
+
+bool ShadowsScene::setGpuCullingEnabled(const bool enabled) {
+    if(enabled && !GpuCulling::isSupported()) {
+        Warning() << "GPU culling needs OpenGL 4.3, culling on the CPU";
+        return false;
+    }
+
+    if(enabled && !_gpuCulling.isSetup()) {
+        _gpuCulling.addSource(_staticCasterIndex);
+        _gpuCulling.addSource(_dynamicCasterIndex);
+        _gpuCulling.addSource(_receiverIndex);
+        _gpuCulling.setup();
+        setupGpuCullingViews();
+    }
+
+    /* Objects moved in the meantime weren't uploaded */
+    if(enabled && !_gpuCullingEnabled) _gpuCulling.invalidate();
+
+    _gpuCullingEnabled = enabled;
+    return true;
+}
+
+void ShadowsScene::setOcclusionCullingEnabled(const bool enabled) {
+    /* Whatever got read before may be long out of date once enabled again */
+    if(!enabled) _occlusionCuller.invalidate();
+
+    _occlusionCullingEnabled = enabled;
+}
+
+/* Static and dynamic casters of each shadow layer, in the order the light
+   expects them, and the receivers last */
+void ShadowsScene::setupGpuCullingViews() {
+    enum: UnsignedInt { StaticCasters, DynamicCasters, Receivers };
+
+    std::vector<UnsignedInt> views;
+    for(std::size_t i = 0; i != _shadowLight.layerCount(); ++i) {
+        views.push_back(StaticCasters);
+        views.push_back(DynamicCasters);
+    }
+    views.push_back(Receivers);
+    _gpuCulling.setViews(views);
+}
+
+void ShadowsScene::drawShadows() {
+    _uniforms.beginFrame();
+
+    _shadowLight.setTarget({ 3, 2, 3 }, Vector3::zAxis(), _camera);
+    _cameraMatrix = Examples::cameraMatrix(_camera);
+    _viewProjectionMatrix = _camera.projectionMatrix()*_cameraMatrix;
+
+    /* Rendering the shadows cleans the static caster objects, which most
+       receivers share, so the receivers have to see them dirty first. The
+       ones no caster index sees are cleaned here, otherwise they'd count
+       as moved every frame. */
+    _receiverIndex.refit(false, _threadPool);
+    for(Object3D* object: _receiverOnlyObjects) object->setClean();
+    _shadowLight.prepare(_staticCasterIndex, _dynamicCasterIndex, _threadPool);
+
+    if(_gpuCullingEnabled) {
+        /* Nothing's read back meanwhile, and what was is getting stale */
+        if(_occlusionCullingEnabled) _occlusionCuller.invalidate();
+
+        _gpuCulling.update();
+        _shadowLight.cull(_gpuCulling);
+        _gpuCulling.cull(UnsignedInt(_shadowLight.cullTaskCount()),
+                         Frustum::fromMatrix(_viewProjectionMatrix));
+        _gpuCulling.finishCulling();
+    } else {
+        /* A static object that moved may have uncovered what was behind
+           it */
+        if(_occlusionCullingEnabled) {
+            if(_shadowLight.staticCastersMoved()) _occlusionCuller.invalidate();
+            _occlusionCuller.update(_cameraMatrix, _threadPool);
+        }
+
+        /* The camera is just one more culling task next to the shadow
+           layers, and all of them run at once */
+        selectLods();
+
+        const std::size_t shadowTasks = _shadowLight.cullTaskCount();
+        _threadPool.parallelFor(shadowTasks + 1, [&](const std::size_t task) {
+            if(task < shadowTasks) _shadowLight.cull(task, _models);
+            else cullReceivers();
+        });
+    }
+
+    GL::Renderer::setFaceCullingMode(GL::Renderer::PolygonFacing::Front);
+    {
+        _shadowLight.render(*_shadowCasterShader, _uniforms, _models);
+    }
+    GL::Renderer::setFaceCullingMode(GL::Renderer::PolygonFacing::Back);
+}
+
+/**
+ * @brief Pick the LOD of every caster and receiver
+ *
+ * By the projected size of the bounding sphere in the main camera, with
+ * the bias of the pass it's drawn in. Each drawable is in exactly one
+ * index, so the batches never write to the same one.
+ *
+ */
+void ShadowsScene::selectLods() {
+    const SpatialIndex* const indices[]{ &_staticCasterIndex,
+                                         &_dynamicCasterIndex,
+                                         &_receiverIndex };
+    std::size_t batchOffsets[4]{};
+    for(std::size_t i = 0; i != 3; ++i) {
+        batchOffsets[i + 1] = batchOffsets[i] +
+            (indices[i]->size() + LodBatchSize - 1)/LodBatchSize;
+    }
+
+    /* Projected size of a unit sphere at unit distance */
+    const Float projectionScale = _camera.projectionMatrix()[1][1];
+    const Vector3 eye = _cameraObject.absoluteTransformationMatrix().translation();
+
+    _threadPool.parallelFor(batchOffsets[3], [&](const std::size_t batch) {
+        std::size_t i = 0;
+        while(batch >= batchOffsets[i + 1]) ++i;
+
+        const SpatialIndex& index = *indices[i];
+        const bool receivers = &index == &_receiverIndex;
+        const Float scale = projectionScale*(receivers ? _lodBias : _shadowLodBias);
+        const std::size_t begin = (batch - batchOffsets[i])*LodBatchSize;
+        const std::size_t end = Math::min(begin + LodBatchSize, index.size());
+        for(std::size_t entry = begin; entry != end; ++entry) {
+            const Vector4 sphere = index.boundingSphere(entry);
+            const Float distance = Math::max((sphere.xyz() - eye).length(), MainCameraNear);
+            const Float screenSize = sphere.w()*scale/distance;
+
+            if(receivers) {
+                auto& drawable = static_cast<ShadowReceiverDrawable&>(index.drawable(entry));
+                drawable.setLod(drawable.model().selectLod(drawable.lod(), screenSize, LodHysteresis));
+            } else {
+                auto& drawable = static_cast<ShadowCasterDrawable&>(index.drawable(entry));
+                drawable.setLod(drawable.model().selectLod(drawable.lod(), screenSize, LodHysteresis));
+            }
+        }
+    });
+}
+
+/**
+ * @brief Collect receivers whose bounding sphere intersects the camera frustum
+ *
+ * The frustum is taken in world space, where the index keeps the bounding
+ * spheres. Runs on a worker thread, so it only reads the index and fills
+ * the draw list.
+ *
+ */
+void ShadowsScene::cullReceivers() {
+    _receiverIndex.query(Frustum::fromMatrix(_viewProjectionMatrix),
+                         Matrix4{}, _visibleReceivers);
+
+    /* Front to back, so nearer instances of a model occlude the ones
+       behind them before those get shaded */
+    sortFrontToBack(_visibleReceivers, _cameraMatrix);
+
+    _receivers.reset(_models);
+    _occludedCount = 0;
+    for(const DrawableTransformations::value_type& receiver: _visibleReceivers) {
+        auto& drawable = static_cast<ShadowReceiverDrawable&>(receiver.first.get());
+
+        const Float radius = receiver.second.scaling().max()*drawable.model().radius;
+        if(_occlusionCuller.isOccluded(receiver.second.translation(), radius)) {
+            ++_occludedCount;
+            continue;
+        }
+
+        const Float depth = -_cameraMatrix.transformPoint(receiver.second.translation()).z();
+        _receivers.add(drawable.model().lod(_models, drawable.lod()),
+                       receiver.second, depth);
+    }
+}
+
+void ShadowsScene::draw(GL::AbstractFramebuffer& framebuffer) {
+    GL::Renderer::setClearColor({0.1f, 0.1f, 0.4f, 1.0f});
+    framebuffer.clear(GL::FramebufferClear::Color | GL::FramebufferClear::Depth)
+               .bind();
+
+    /* Uploaded once, whichever receiver shaders end up reading it */
+    FrameUniforms frame;
+    for(std::size_t i = 0; i != _shadowLight.layerCount(); ++i) {
+        frame.shadowmapMatrices[i] = _shadowLight.layerMatrices()[i];
+        frame.shadowmapRects[i] = _shadowLight.layerRects()[i];
+    }
+    frame.lightDirection = _shadowLightObject.transformation().backward();
+    frame.shadowBias = _shadowBias;
+    _uniforms.bind(FrameUniformBinding, frame);
+    _uniforms.bind(DrawUniformBinding, DrawUniforms{ _viewProjectionMatrix });
+
+    if(_shadowMode == ShadowMode::Variance) {
+        _shadowReceiverShader->setShadowmapTexture(_shadowLight.momentsTexture());
+    } else {
+        _shadowReceiverShader->setShadowmapTexture(_shadowAtlas.texture());
+    }
+
+    _statistics = {};
+    if(_gpuCullingEnabled) {
+        _drawnCount = _culledCount = _occludedCount = 0;
+        _gpuCulling.draw(UnsignedInt(_shadowLight.cullTaskCount()),
+                         *_shadowReceiverShader, _statistics);
+        return;
+    }
+
+    /* Visible objects sharing a model are drawn with a single instanced
+       draw call, the one with the nearest instance first */
+    _drawnCount = _receivers.size();
+    _culledCount = _receiverIndex.size() - _drawnCount;
+    _receivers.enqueue(_queue, *_shadowReceiverShader, _models);
+    _queue.submit(_statistics);
+
+    /* Read back while the next frame is being prepared */
+    if(_occlusionCullingEnabled) {
+        _occlusionCuller.capture(framebuffer, _camera.projectionMatrix(), _cameraMatrix);
+    }
+}
+
+}}
@@ -0,0 +1,370 @@
+#ifndef Magnum_Examples_Shadows_ShadowsScene_h
+#define Magnum_Examples_Shadows_ShadowsScene_h
+
+#include <string>
+#include <vector>
+#include <Corrade/Containers/Optional.h>
+#include <Magnum/GL/AbstractFramebuffer.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/SceneGraph/Drawable.h>
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+#include <Magnum/SceneGraph/Scene.h>
+#include <Corrade/Utility/Utility.h>
+#include <Magnum/Trade/Trade.h>
+
+#include "GpuCulling.h"
+#include "Model.h"
+#include "OcclusionCuller.h"
+#include "ShadowAtlas.h"
+#include "ShaderVariants.h"
+#include "ShadowLight.h"
+#include "SpatialIndex.h"
+#include "ThreadPool.h"
+#include "Types.h"
+#include "UniformRing.h"
+#include "Uniforms.h"
+
+namespace Magnum { namespace Examples {
+
+constexpr const Float MainCameraNear = 0.01f;
+constexpr const Float MainCameraFar = 100.0f;
+
+/**
+ * @brief How @ref ShadowsScene::populate() generates the scene
+ *
+ * The same seed and options always produce the same scene, on any
+ * platform.
+ */
+struct SceneOptions {
+    /**
+     * @brief Add the options to a command-line parser
+     *
+     * Defaults match a default-constructed instance.
+     */
+    static void addArguments(Utility::Arguments& arguments);
+
+    /**
+     * @brief Options from a command-line parser
+     *
+     * Prints a message and returns @ref Containers::NullOpt if the values
+     * can't generate a scene.
+     */
+    static Containers::Optional<SceneOptions> fromArguments(const Utility::Arguments& arguments);
+
+    enum class HeightDistribution {
+        Uniform,    /**< Evenly between the min and max */
+        Ground      /**< Most objects close to the min */
+    };
+
+    std::size_t objectCount { 200 };
+    UnsignedLong seed { 1 };
+
+    /** @brief Width and depth of the square the objects are scattered in */
+    Float area { 100.0f };
+
+    Vector2 height { 0.0f, 5.0f };
+    HeightDistribution heightDistribution { HeightDistribution::Uniform };
+
+    /** @brief Relative frequency of the cube, low- and high-poly capsule */
+    Vector3 modelMix { 1.0f, 1.0f, 1.0f };
+
+    /** @brief Fraction of casters marked as dynamic */
+    Float dynamicRatio { 0.0f };
+
+    /** @brief Store model positions as half-floats, see @ref compactMesh() */
+    bool halfPositions { false };
+
+    /** @brief Give the capsules coarser variants, see @ref ShadowsScene::addLod() */
+    bool lods { true };
+
+    /**
+     * @brief File to load instead of generating the scene
+     *
+     * Not used by @ref ShadowsScene::populate(), the applications stream
+     * it in with a @ref SceneLoader instead of calling it.
+     */
+    std::string file;
+
+    /**
+     * @brief Where preprocessed meshes are kept between runs
+     *
+     * Meshes are preprocessed every time if empty, see @ref MeshCache.
+     */
+    std::string meshCache;
+
+    /**
+     * @brief Where linked shader programs are kept between runs
+     *
+     * Not used by @ref ShadowsScene::populate(), but passed to the
+     * @ref ShadowsScene constructor.
+     */
+    std::string shaderCache;
+};
+
+/**
+ * @brief The scene, its shadow light and both render passes
+ *
+ * Everything that's needed to render a frame, without a window or UI, so
+ * the interactive example and the headless benchmark draw exactly the
+ * same thing. Needs a current GL context for its whole lifetime.
+ *
+ * Updating the bounding volumes, culling and building the draw lists of
+ * every pass happens on a thread pool, the thread owning the GL context
+ * only submits the draws.
+ *
+ */
+class ShadowsScene {
+    public:
+        /**
+         * @brief Constructor
+         * @param workerThreads Threads helping with culling besides the
+         *      calling one, zero does everything on the calling thread
+         * @param shaderCache   Directory to keep linked shader programs in
+         *      between runs, see @ref ShaderVariants
+         */
+        explicit ShadowsScene(std::size_t workerThreads = ThreadPool::defaultWorkerCount(), const std::string& shaderCache = {});
+
+        /* The drawables point to the models and the scene graph objects
+           to each other, so this can't be moved */
+        ShadowsScene(const ShadowsScene&) = delete;
+        ShadowsScene& operator=(const ShadowsScene&) = delete;
+
+        /**
+         * @brief Generate geometry for later compilation into meshes
+         *
+         * Has to be called before any @ref createSceneObject(), since adding
+         * a model may move the existing ones. The mesh goes through
+         * @ref compactMesh() first, with all models expected to agree on
+         * @p halfPositions.
+         */
+        Model& addModel(const Trade::MeshData& meshData, bool halfPositions = false);
+
+        /**
+         * @brief Add a model from already preprocessed data
+         *
+         * Only uploads @p data, the expensive part of @ref addModel() can
+         * be done on another thread or come from a @ref MeshCache. Models
+         * can be added after objects only if there's room for them, see
+         * @ref reserveModels().
+         */
+        Model& addModel(const CompactMeshView& data);
+
+        /**
+         * @brief Make room for more models
+         *
+         * Has to be called before any @ref createSceneObject(), models
+         * added after that and fitting into the reserved space can then be
+         * added any time.
+         */
+        void reserveModels(std::size_t count);
+
+        /**
+         * @brief Add a coarser variant of a model
+         * @param model         Index of the model in @ref models()
+         * @param meshData      Mesh of the variant
+         * @param maxScreenSize Projected size the variant is used below,
+         *      as a fraction of the viewport height. Expected to be smaller
+         *      than for the previous variants of the same model.
+         * @param halfPositions Same as for @ref addModel()
+         *
+         * The variant is added as a model of its own, with the same
+         * restrictions as @ref addModel().
+         */
+        void addLod(std::size_t model, const Trade::MeshData& meshData, Float maxScreenSize, bool halfPositions = false);
+
+        /** @overload */
+        void addLod(std::size_t model, const CompactMeshView& data, Float maxScreenSize);
+
+        /** @brief Add a caster and/or receiver object to the scene */
+        Object3D* createSceneObject(Model& model, bool makeCaster = true, bool makeReceiver = true, bool isDynamic = false);
+
+        /** @brief Populate with the ground and randomly placed primitives */
+        void populate(const SceneOptions& options = SceneOptions{});
+
+        /** @brief Set size of the framebuffer the scene is drawn into */
+        void setViewport(const Vector2i& size);
+
+        /**
+         * @brief Reallocate the shadow maps in the atlas
+         *
+         * The nearest level gets @p shadowMapSize, the others smaller tiles,
+         * see @ref ShadowLight::layerTileSize(). The atlas is recreated at
+         * the smallest size that fits them. If that would be larger than
+         * 4096, the previous configuration is kept and @cpp false @ce
+         * returned. The receiver shader is recompiled if the level count
+         * changes. At most @ref MaxShadowMapLevels levels are supported.
+         */
+        bool setupShadowmaps(Int shadowMapLevels, Int shadowMapSize);
+
+        void setShadowBias(Float bias);
+
+        /**
+         * @brief Switch between hard and filtered shadows
+         *
+         * Switches to the receiver shader of the mode, compiling it if it
+         * wasn't yet. The caster shader is the same for both.
+         */
+        void setShadowMode(ShadowMode mode);
+        void setShadowSplitLambda(Float lambda);
+
+        /**
+         * @brief Scale the projected size LODs are picked by
+         *
+         * Values below one switch to coarser LODs closer to the camera.
+         * The main and shadow pass have their own, the shadow one
+         * defaulting to a much lower value as coarser depth-only casters
+         * are rarely noticeable. Casters pick their LOD by their distance
+         * from the main camera as well. With GPU culling everything is
+         * drawn at full detail.
+         */
+        void setLodBias(Float bias) { _lodBias = bias; }
+        void setShadowLodBias(Float bias) { _shadowLodBias = bias; }
+
+        Float lodBias() const { return _lodBias; }
+        Float shadowLodBias() const { return _shadowLodBias; }
+
+        Float shadowBias() const { return _shadowBias; }
+        ShadowMode shadowMode() const { return _shadowMode; }
+        Float shadowSplitLambda() const { return _shadowSplitLambda; }
+        Int shadowMapSize() const { return _shadowMapSize; }
+        Int shadowMapLevels() const { return _shadowMapLevels; }
+
+        /**
+         * @brief Cull and draw on the GPU
+         *
+         * Replaces the culling on the thread pool with compute shaders and
+         * indirect draws. Returns @cpp false @ce and keeps culling on the
+         * CPU if the context doesn't support it, see
+         * @ref GpuCulling::isSupported(). Has to be called after
+         * @ref populate(). The drawn and culled counts aren't known with
+         * GPU culling and are reported as zero.
+         */
+        bool setGpuCullingEnabled(bool enabled);
+
+        bool isGpuCullingEnabled() const { return _gpuCullingEnabled; }
+
+        /**
+         * @brief Skip receivers hidden behind others in an earlier frame
+         *
+         * Each @ref draw() reads the depth back, and receivers it shows
+         * to be hidden are culled a few frames later, see
+         * @ref OcclusionCuller for when it holds back. Static casters
+         * moving drop the depth read so far, dynamic ones aren't tracked.
+         * Only the culling on the CPU does this, with
+         * @ref setGpuCullingEnabled() it has no effect.
+         * The framebuffer passed to @ref draw() has to be single-sampled.
+         */
+        void setOcclusionCullingEnabled(bool enabled);
+
+        bool isOcclusionCullingEnabled() const { return _occlusionCullingEnabled; }
+
+        /**
+         * @brief Fit the shadow maps to the camera and render them
+         *
+         * Culls the receivers for @ref draw() as well, together with the
+         * casters of all shadow map layers.
+         */
+        void drawShadows();
+
+        /**
+         * @brief Render the scene
+         *
+         * Binds and clears @p framebuffer first. Expects @ref drawShadows()
+         * to be called before, with the camera at the same place.
+         */
+        void draw(GL::AbstractFramebuffer& framebuffer);
+
+        Object3D& cameraObject() { return _cameraObject; }
+        SceneGraph::Camera3D& camera() { return _camera; }
+        ShadowLight& shadowLight() { return _shadowLight; }
+        ShadowAtlas& shadowAtlas() { return _shadowAtlas; }
+        std::vector<Model>& models() { return _models; }
+        ThreadPool& threadPool() { return _threadPool; }
+        const ShaderVariants& shaderVariants() const { return _shaders; }
+
+        /**
+         * @brief Compile the shaders one setting change away
+         *
+         * Both shadow modes with the current and the neighbouring level
+         * counts, see @ref ShaderVariants::precompile(). Switching to them
+         * then doesn't stall the frame. Returns how many were compiled.
+         */
+        std::size_t precompileShaders() { return _shaders.precompile(_shadowMapLevels); }
+
+        /** @brief Receivers drawn and culled by the last @ref draw() */
+        std::size_t drawnCount() const { return _drawnCount; }
+        std::size_t culledCount() const { return _culledCount; }
+
+        /**
+         * @brief Receivers in the frustum but hidden by others
+         *
+         * Counted in @ref culledCount() as well. Zero without
+         * @ref setOcclusionCullingEnabled().
+         */
+        std::size_t occludedCount() const { return _occludedCount; }
+
+        /** @brief Draw calls and triangles of the last @ref draw() */
+        const DrawStatistics& statistics() const { return _statistics; }
+
+    private:
+        void selectLods();
+        void cullReceivers();
+        void setupGpuCullingViews();
+
+        /* Destroyed last, nothing should be running on it then anymore */
+        ThreadPool _threadPool;
+
+        Scene3D _scene;
+        SpatialIndex _staticCasterIndex;
+        SpatialIndex _dynamicCasterIndex;
+        SpatialIndex _receiverIndex;
+
+        /* Receivers without a caster, nothing else cleans them */
+        std::vector<Object3D*> _receiverOnlyObjects;
+        GpuCulling _gpuCulling;
+        OcclusionCuller _occlusionCuller{ NoCreate };
+
+        /* Every variant used so far, the current ones point into it */
+        ShaderVariants _shaders;
+        ShadowCasterShader* _shadowCasterShader{};
+        ShadowReceiverShader* _shadowReceiverShader{};
+
+        /* Per-frame and per-pass blocks of all shaders */
+        UniformRing _uniforms{ NoCreate };
+
+        /* Has to outlive the light, which gives its tiles back on
+           destruction */
+        ShadowAtlas _shadowAtlas{ NoCreate };
+
+        Object3D _shadowLightObject;
+        Object3D _cameraObject;
+
+        ShadowLight _shadowLight;
+        SceneGraph::Camera3D _camera;
+
+        std::vector<Model> _models;
+
+        /* Reused every frame so drawing doesn't allocate */
+        DrawableTransformations _visibleReceivers;
+        DrawList _receivers;
+        RenderQueue _queue{ RenderQueue::Order::FrontToBack };
+        Matrix4 _cameraMatrix, _viewProjectionMatrix;
+
+        std::size_t _drawnCount{}, _culledCount{}, _occludedCount{};
+        DrawStatistics _statistics;
+
+        Float _shadowBias { 0.003f };
+        ShadowMode _shadowMode { ShadowMode::Hard };
+        Int _maxShadowAtlasSize { 4096 };
+        Int _shadowMapSize { 1024 };
+        Int _shadowMapLevels { 4 };
+        Float _shadowSplitLambda { 0.75f };
+        Float _lodBias { 1.0f };
+        Float _shadowLodBias { 0.5f };
+        bool _gpuCullingEnabled{};
+        bool _occlusionCullingEnabled{};
+};
+
+}}
+
+#endif
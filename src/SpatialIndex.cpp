@@ -0,0 +1,179 @@
+#include "SpatialIndex.h"
+
+#include <algorithm>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Intersection.h>
+#include <Magnum/SceneGraph/AbstractObject.h>
+#include <Magnum/SceneGraph/Drawable.h>
+
+#include "ThreadPool.h"
+
+namespace Magnum { namespace Examples {
+
+namespace {
+
+Range3D sphereBounds(const Vector3& center, const Float radius) {
+    return { center - Vector3{ radius }, center + Vector3{ radius } };
+}
+
+}
+
+void SpatialIndex::add(SceneGraph::Drawable3D& drawable,
+                       const Float radius,
+                       const UnsignedInt modelId) {
+    _entries.push_back({ &drawable, {}, {}, radius, {}, modelId });
+    _needsRebuild = true;
+}
+
+std::size_t SpatialIndex::refit(const bool cleanObjects, ThreadPool& pool) {
+    /* Walking up the parents for the absolute transformation is the
+       expensive part and only reads the scene graph, so that's done in
+       parallel. Every entry has its own flag, nothing is shared. */
+    _entryMoved.resize(_entries.size());
+    const std::size_t batchCount = (_entries.size() + RefitBatchSize - 1)/RefitBatchSize;
+    pool.parallelFor(batchCount, [this](const std::size_t batch) {
+        const std::size_t end = Math::min(_entries.size(), (batch + 1)*RefitBatchSize);
+        for(std::size_t i = batch*RefitBatchSize; i != end; ++i) {
+            Entry& entry = _entries[i];
+            const SceneGraph::AbstractObject3D& object = entry.drawable->object();
+            _entryMoved[i] = _needsRebuild || object.isDirty();
+            if(!_entryMoved[i]) continue;
+
+            entry.transformation = object.absoluteTransformationMatrix();
+            entry.center = entry.transformation.translation();
+            entry.radius = entry.transformation.scaling().max()*entry.localRadius;
+        }
+    });
+
+    _movedEntries.clear();
+    for(std::size_t i = 0; i != _entries.size(); ++i) {
+        if(!_entryMoved[i]) continue;
+        if(cleanObjects) _entries[i].drawable->object().setClean();
+        _movedEntries.push_back(UnsignedInt(i));
+    }
+
+    if(_needsRebuild) {
+        rebuild();
+        return _movedEntries.size();
+    }
+
+    /* A few moved objects are cheaper to propagate one by one, many of them
+       touch most of the nodes anyway. Children come after their parents,
+       so going backwards updates them first. */
+    if(_movedEntries.size()*8 > _nodes.size()) {
+        for(std::size_t i = _nodes.size(); i != 0; --i) {
+            updateBounds(UnsignedInt(i - 1));
+        }
+    } else for(const UnsignedInt entry: _movedEntries) {
+        UnsignedInt node = _entryLeaves[entry];
+        for(;;) {
+            updateBounds(node);
+            if(node == 0) break;
+            node = _nodes[node].parent;
+        }
+    }
+
+    return _movedEntries.size();
+}
+
+void SpatialIndex::rebuild() {
+    _nodes.clear();
+    _entryLeaves.assign(_entries.size(), 0);
+    if(!_entries.empty()) {
+        _nodes.reserve(2*(_entries.size()/LeafSize + 1));
+        build(0, UnsignedInt(_entries.size()), 0);
+    }
+    _needsRebuild = false;
+}
+
+/* Top-down, splitting at the median along the longest axis of the sphere
+   centers */
+UnsignedInt SpatialIndex::build(const UnsignedInt first,
+                                const UnsignedInt count,
+                                const UnsignedInt parent) {
+    const UnsignedInt index = UnsignedInt(_nodes.size());
+    _nodes.push_back({ {}, parent, 0, first, 0 });
+
+    if(count <= LeafSize) {
+        _nodes[index].count = count;
+        for(UnsignedInt i = first; i != first + count; ++i) {
+            _entryLeaves[i] = index;
+        }
+        updateBounds(index);
+        return index;
+    }
+
+    Range3D centers{ _entries[first].center, _entries[first].center };
+    for(UnsignedInt i = first + 1; i != first + count; ++i) {
+        centers = Math::join(centers, Range3D{ _entries[i].center, _entries[i].center });
+    }
+    const Vector3 extent = centers.size();
+    const std::size_t axis = extent.x() > extent.y() ?
+        (extent.x() > extent.z() ? 0 : 2) :
+        (extent.y() > extent.z() ? 1 : 2);
+
+    const UnsignedInt middle = first + count/2;
+    std::nth_element(_entries.begin() + first,
+                     _entries.begin() + middle,
+                     _entries.begin() + first + count,
+                     [axis](const Entry& a, const Entry& b) {
+                         return a.center[axis] < b.center[axis];
+                     });
+
+    build(first, middle - first, index);
+    const UnsignedInt rightChild = build(middle, first + count - middle, index);
+    _nodes[index].rightChild = rightChild;
+    updateBounds(index);
+    return index;
+}
+
+void SpatialIndex::updateBounds(const UnsignedInt index) {
+    Node& node = _nodes[index];
+
+    if(node.count) {
+        const Entry& firstEntry = _entries[node.first];
+        Range3D bounds = sphereBounds(firstEntry.center, firstEntry.radius);
+        for(UnsignedInt i = node.first + 1; i != node.first + node.count; ++i) {
+            bounds = Math::join(bounds, sphereBounds(_entries[i].center, _entries[i].radius));
+        }
+        node.bounds = bounds;
+    } else {
+        node.bounds = Math::join(_nodes[index + 1].bounds,
+                                 _nodes[node.rightChild].bounds);
+    }
+}
+
+void SpatialIndex::query(const Frustum& frustum,
+                         const Matrix4& cameraMatrix,
+                         DrawableTransformations& out) const {
+    CORRADE_INTERNAL_ASSERT(!_needsRebuild);
+
+    out.clear();
+    if(_nodes.empty()) return;
+
+    /* Median splits keep the depth logarithmic, this is plenty */
+    UnsignedInt stack[64];
+    std::size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while(stackSize) {
+        const UnsignedInt index = stack[--stackSize];
+        const Node& node = _nodes[index];
+        if(!Math::Intersection::rangeFrustum(node.bounds, frustum)) continue;
+
+        if(!node.count) {
+            stack[stackSize++] = node.rightChild;
+            stack[stackSize++] = index + 1;
+            continue;
+        }
+
+        for(UnsignedInt i = node.first; i != node.first + node.count; ++i) {
+            const Entry& entry = _entries[i];
+            if(Math::Intersection::sphereFrustum(entry.center, entry.radius, frustum)) {
+                out.emplace_back(*entry.drawable, cameraMatrix*entry.transformation);
+            }
+        }
+    }
+}
+
+}}
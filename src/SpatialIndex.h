@@ -0,0 +1,143 @@
+#ifndef Magnum_Examples_Shadows_SpatialIndex_h
+#define Magnum_Examples_Shadows_SpatialIndex_h
+
+#include <vector>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/Math/Range.h>
+
+#include "DrawList.h"
+
+namespace Magnum { namespace Examples {
+
+class ThreadPool;
+
+/**
+ * @brief Bounding volume hierarchy over world-space bounding spheres
+ *
+ * Holds drawables together with the world transformation and bounding
+ * sphere of their objects. Queries walk the tree and skip whole subtrees
+ * outside of the frustum, so their cost grows with the number of visible
+ * drawables rather than with all of them.
+ *
+ * Objects that moved are picked up by @ref refit(), which updates their
+ * spheres and the bounds of the nodes above them without changing the
+ * tree structure. The tree is built the first time @ref refit() is called
+ * after adding drawables.
+ *
+ */
+class SpatialIndex {
+    public:
+        /**
+         * @brief Add a drawable
+         * @param drawable  Drawable to return from queries
+         * @param radius    Bounding sphere radius in model space, scaled by
+         *      the object transformation
+         * @param modelId   Model the drawable is an instance of, used only
+         *      by the GPU culling
+         */
+        void add(SceneGraph::Drawable3D& drawable, Float radius, UnsignedInt modelId = 0);
+
+        std::size_t size() const { return _entries.size(); }
+
+        /** @brief Bounds of all drawables, valid after @ref refit() */
+        Range3D bounds() const {
+            return _nodes.empty() ? Range3D{} : _nodes.front().bounds;
+        }
+
+        /**
+         * @brief Entries updated by the last @ref refit()
+         *
+         * All entries if the tree got rebuilt, as that reorders them.
+         */
+        Containers::ArrayView<const UnsignedInt> movedEntries() const {
+            return { _movedEntries.data(), _movedEntries.size() };
+        }
+
+        /** @brief Drawable of an entry */
+        SceneGraph::Drawable3D& drawable(std::size_t entry) const {
+            return *_entries[entry].drawable;
+        }
+
+        /** @brief World transformation of an entry */
+        const Matrix4& transformation(std::size_t entry) const {
+            return _entries[entry].transformation;
+        }
+
+        /** @brief World-space bounding sphere of an entry, radius in W */
+        Vector4 boundingSphere(std::size_t entry) const {
+            return { _entries[entry].center, _entries[entry].radius };
+        }
+
+        UnsignedInt modelId(std::size_t entry) const {
+            return _entries[entry].modelId;
+        }
+
+        /**
+         * @brief Update drawables whose object moved
+         * @param cleanObjects  Clean the objects after reading their new
+         *      transformation
+         * @param pool          Pool the world transformations are
+         *      calculated on
+         *
+         * Objects are considered moved if they're dirty. Objects that are
+         * never cleaned, like the ones only indexed with @p cleanObjects
+         * disabled, get updated every time. The scene graph is only read
+         * from the workers, cleaning and updating the tree happens on the
+         * calling thread. Returns the number of updated drawables.
+         */
+        std::size_t refit(bool cleanObjects, ThreadPool& pool);
+
+        /**
+         * @brief Collect drawables whose bounding sphere intersects a frustum
+         * @param frustum       World-space frustum
+         * @param cameraMatrix  Matrix the world transformations are
+         *      multiplied with for @p out
+         * @param out           Filled with the drawables, keeping its
+         *      capacity
+         *
+         * Expects @ref refit() to be called after the last @ref add().
+         */
+        void query(const Frustum& frustum, const Matrix4& cameraMatrix, DrawableTransformations& out) const;
+
+    private:
+        enum: UnsignedInt {
+            LeafSize = 8,
+            /* Entries refitted by one pool iteration, a few thousand
+               matrix multiplications are worth handing out */
+            RefitBatchSize = 256
+        };
+
+        struct Entry {
+            SceneGraph::Drawable3D* drawable;
+            Matrix4 transformation;
+            Vector3 center;
+            Float localRadius;
+            Float radius;
+            UnsignedInt modelId;
+        };
+
+        /* Inner nodes have their left child right after them */
+        struct Node {
+            Range3D bounds;
+            UnsignedInt parent;
+            UnsignedInt rightChild;
+            UnsignedInt first;
+            UnsignedInt count;   /* Zero for inner nodes */
+        };
+
+        void rebuild();
+        UnsignedInt build(UnsignedInt first, UnsignedInt count, UnsignedInt parent);
+        void updateBounds(UnsignedInt node);
+
+        std::vector<Entry> _entries;
+        std::vector<Node> _nodes;
+        std::vector<UnsignedInt> _entryLeaves;
+        std::vector<UnsignedInt> _movedEntries;
+        std::vector<UnsignedByte> _entryMoved;
+        bool _needsRebuild{};
+};
+
+}}
+
+#endif
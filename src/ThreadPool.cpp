@@ -0,0 +1,107 @@
+#include "ThreadPool.h"
+
+namespace Magnum { namespace Examples {
+
+std::size_t ThreadPool::defaultWorkerCount() {
+    #ifdef CORRADE_TARGET_EMSCRIPTEN
+    /* No threads without SharedArrayBuffer */
+    return 0;
+    #else
+    const std::size_t hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    #endif
+}
+
+ThreadPool::ThreadPool(const std::size_t workerCount):
+    _shares{new Share[workerCount + 1]}
+{
+    for(std::size_t i = 0; i != workerCount + 1; ++i) {
+        _shares[i].next = 0;
+        _shares[i].end = 0;
+    }
+
+    /* The calling thread is participant 0 */
+    _workers.reserve(workerCount);
+    for(std::size_t i = 0; i != workerCount; ++i) {
+        _workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _stopping = true;
+    }
+    _started.notify_all();
+
+    for(std::thread& worker: _workers) worker.join();
+}
+
+void ThreadPool::run(const std::size_t count,
+                     void(*const function)(void*, std::size_t),
+                     void* const state) {
+    if(!count) return;
+
+    /* Not worth waking anybody up */
+    if(_workers.empty() || count == 1) {
+        for(std::size_t i = 0; i != count; ++i) function(state, i);
+        return;
+    }
+
+    const std::size_t participants = _workers.size() + 1;
+    for(std::size_t i = 0; i != participants; ++i) {
+        _shares[i].next.store(count*i/participants, std::memory_order_relaxed);
+        _shares[i].end = count*(i + 1)/participants;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _function = function;
+        _state = state;
+        _running = _workers.size();
+        ++_generation;
+    }
+    _started.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock{_mutex};
+    _finished.wait(lock, [this]{ return _running == 0; });
+}
+
+void ThreadPool::work(const std::size_t participant) {
+    const std::size_t participants = _workers.size() + 1;
+
+    /* Own share first, then whatever is left in the others */
+    for(std::size_t offset = 0; offset != participants; ++offset) {
+        Share& share = _shares[(participant + offset) % participants];
+        for(;;) {
+            const std::size_t i = share.next.fetch_add(1, std::memory_order_relaxed);
+            if(i >= share.end) break;
+            _function(_state, i);
+        }
+    }
+}
+
+void ThreadPool::workerLoop(const std::size_t participant) {
+    std::size_t generation = 0;
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _started.wait(lock, [&]{ return _stopping || _generation != generation; });
+            if(_stopping) return;
+            generation = _generation;
+        }
+
+        work(participant);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            last = --_running == 0;
+        }
+        if(last) _finished.notify_one();
+    }
+}
+
+}}
@@ -0,0 +1,80 @@
+#ifndef Magnum_Examples_Shadows_ThreadPool_h
+#define Magnum_Examples_Shadows_ThreadPool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <Magnum/Magnum.h>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Fixed set of worker threads running parallel loops
+ *
+ * The calling thread takes part in every loop, so a pool without workers
+ * runs everything inline. Each participant starts on its own contiguous
+ * share of the iterations and, once done, steals single iterations from
+ * the others, so uneven iterations still keep everyone busy. Starting a
+ * loop doesn't allocate.
+ *
+ */
+class ThreadPool {
+    public:
+        /** @brief One worker per hardware thread besides the calling one */
+        static std::size_t defaultWorkerCount();
+
+        explicit ThreadPool(std::size_t workerCount = defaultWorkerCount());
+
+        /** @brief Stops and joins the workers */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        std::size_t workerCount() const { return _workers.size(); }
+
+        /**
+         * @brief Call @p function for every index in @cpp [0, count) @ce
+         *
+         * Returns once all calls are done. The calls may run in any order
+         * and concurrently, and mustn't start another loop on the same pool.
+         */
+        template<class F> void parallelFor(std::size_t count, F&& function) {
+            run(count, [](void* state, std::size_t i) {
+                (*static_cast<typename std::remove_reference<F>::type*>(state))(i);
+            }, &function);
+        }
+
+    private:
+        /* Padded to a cache line, they get hammered from all threads.
+           Not alignas(), over-aligned new isn't there before C++17. */
+        struct Share {
+            std::atomic<std::size_t> next;
+            std::size_t end;
+            char padding[64 - 2*sizeof(std::size_t)];
+        };
+
+        void run(std::size_t count, void(*function)(void*, std::size_t), void* state);
+        void work(std::size_t participant);
+        void workerLoop(std::size_t participant);
+
+        std::vector<std::thread> _workers;
+        std::unique_ptr<Share[]> _shares;
+
+        std::mutex _mutex;
+        std::condition_variable _started, _finished;
+        std::size_t _generation{};
+        std::size_t _running{};
+        bool _stopping{};
+
+        void(*_function)(void*, std::size_t){};
+        void* _state{};
+};
+
+}}
+
+#endif
@@ -37,6 +37,18 @@ namespace Magnum { namespace Examples {
 typedef SceneGraph::Object<SceneGraph::MatrixTransformation3D> Object3D;
 typedef SceneGraph::Scene<SceneGraph::MatrixTransformation3D> Scene3D;
 
+/** @brief How shadow maps are stored and sampled */
+enum class ShadowMode: UnsignedByte {
+    /** Single depth comparison per fragment, hard and aliased edges */
+    Hard,
+
+    /**
+     * Depth and squared depth, blurred and mipmapped, so the lookup can be
+     * filtered like any other texture
+     */
+    Variance
+};
+
 }}
 
 #endif
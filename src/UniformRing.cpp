@@ -0,0 +1,94 @@
+#include "UniformRing.h"
+
+#include <cstring>
+#include <utility>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+
+namespace Magnum { namespace Examples {
+
+UniformRing::UniformRing(const std::size_t blockCount,
+                         const std::size_t blockSize,
+                         const std::size_t frameCount):
+    _buffer{}, _fences(frameCount, nullptr)
+{
+    /* Ranges bound to uniform blocks have to start at multiples of this */
+    _alignment = std::size_t(GL::Buffer::uniformOffsetAlignment());
+    _segmentSize = blockCount*((blockSize + _alignment - 1)/_alignment*_alignment);
+
+    const std::size_t size = frameCount*_segmentSize;
+    if(GL::Context::current().isExtensionSupported<GL::Extensions::ARB::buffer_storage>()) {
+        _buffer.setStorage({ nullptr, size },
+                           GL::Buffer::StorageFlag::MapWrite |
+                           GL::Buffer::StorageFlag::MapPersistent |
+                           GL::Buffer::StorageFlag::MapCoherent);
+        _mapped = _buffer.map(0, size,
+                              GL::Buffer::MapFlag::Write |
+                              GL::Buffer::MapFlag::Persistent |
+                              GL::Buffer::MapFlag::Coherent);
+        CORRADE_INTERNAL_ASSERT(!_mapped.empty());
+    } else {
+        _buffer.setData({ nullptr, size }, GL::BufferUsage::StreamDraw);
+    }
+}
+
+UniformRing::~UniformRing() {
+    for(GLsync fence: _fences) if(fence) glDeleteSync(fence);
+}
+
+UniformRing::UniformRing(UniformRing&& other) noexcept {
+    *this = std::move(other);
+}
+
+UniformRing& UniformRing::operator=(UniformRing&& other) noexcept {
+    using std::swap;
+    swap(_buffer, other._buffer);
+    swap(_mapped, other._mapped);
+    swap(_alignment, other._alignment);
+    swap(_segmentSize, other._segmentSize);
+    swap(_segment, other._segment);
+    swap(_offset, other._offset);
+    swap(_fences, other._fences);
+    return *this;
+}
+
+void UniformRing::beginFrame() {
+    /* Without the persistent mapping the driver takes care of not
+       overwriting anything still in use */
+    if(!isPersistent()) {
+        _segment = (_segment + 1) % _fences.size();
+        _offset = 0;
+        return;
+    }
+
+    GLsync& current = _fences[_segment];
+    if(current) glDeleteSync(current);
+    current = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    _segment = (_segment + 1) % _fences.size();
+    _offset = 0;
+
+    /* Flushing, so the fence is guaranteed to get signaled at some point */
+    GLsync& next = _fences[_segment];
+    if(!next) return;
+    while(glClientWaitSync(next, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(next);
+    next = nullptr;
+}
+
+void UniformRing::bind(const UnsignedInt binding,
+                       const Containers::ArrayView<const void> data) {
+    CORRADE_INTERNAL_ASSERT(_offset + data.size() <= _segmentSize);
+
+    const std::size_t offset = _segment*_segmentSize + _offset;
+    if(isPersistent()) {
+        std::memcpy(_mapped.data() + offset, data.data(), data.size());
+    } else {
+        _buffer.setSubData(offset, data);
+    }
+
+    _buffer.bind(GL::Buffer::Target::Uniform, binding, offset, data.size());
+    _offset += (data.size() + _alignment - 1)/_alignment*_alignment;
+}
+
+}}
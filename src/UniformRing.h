@@ -0,0 +1,75 @@
+#ifndef Magnum_Examples_Shadows_UniformRing_h
+#define Magnum_Examples_Shadows_UniformRing_h
+
+#include <vector>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/OpenGL.h>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Uniform buffer streaming block data for a few frames in flight
+ *
+ * The buffer is split into one segment per frame. Each @ref bind() copies
+ * a block to the next free place in the current segment and binds that
+ * range, so changing what a draw sees is only a new binding offset. A
+ * fence placed when the frame is done keeps its segment from being
+ * overwritten before the GPU read it.
+ *
+ * With @gl_extension{ARB,buffer_storage} (OpenGL 4.4) the buffer is
+ * mapped persistently and the blocks are plain copies. Otherwise each of
+ * them is uploaded separately.
+ *
+ */
+class UniformRing {
+    public:
+        explicit UniformRing(NoCreateT) {}
+
+        /**
+         * @brief Constructor
+         * @param blockCount    Most blocks bound in one frame
+         * @param blockSize     Size of the largest of them, in bytes
+         * @param frameCount    Frames the GPU may be behind
+         */
+        explicit UniformRing(std::size_t blockCount, std::size_t blockSize, std::size_t frameCount = 3);
+
+        /** @brief Deletes the fences still pending */
+        ~UniformRing();
+
+        UniformRing(const UniformRing&) = delete;
+        UniformRing(UniformRing&& other) noexcept;
+        UniformRing& operator=(const UniformRing&) = delete;
+        UniformRing& operator=(UniformRing&& other) noexcept;
+
+        bool isPersistent() const { return !_mapped.empty(); }
+
+        /**
+         * @brief Switch to the next segment
+         *
+         * Fences everything submitted since the previous call and waits
+         * until the GPU is done with the segment that's going to be
+         * reused. Call at the start of each frame.
+         */
+        void beginFrame();
+
+        /** @brief Copy @p data into the current segment and bind it */
+        void bind(UnsignedInt binding, Containers::ArrayView<const void> data);
+
+        /** @overload */
+        template<class T> void bind(UnsignedInt binding, const T& data) {
+            bind(binding, Containers::ArrayView<const void>{&data, sizeof(T)});
+        }
+
+    private:
+        GL::Buffer _buffer{NoCreate};
+        Containers::ArrayView<char> _mapped;
+
+        std::size_t _alignment{}, _segmentSize{};
+        std::size_t _segment{}, _offset{};
+        std::vector<GLsync> _fences;
+};
+
+}}
+
+#endif
@@ -0,0 +1,13 @@
+/* Same layouts as FrameUniforms and DrawUniforms in Uniforms.h. Expects
+   MAX_SHADOW_MAP_LEVELS to be defined. */
+
+layout(std140) uniform FrameUniforms {
+    highp mat4 shadowmapMatrix[MAX_SHADOW_MAP_LEVELS];
+    highp vec4 shadowmapRect[MAX_SHADOW_MAP_LEVELS];
+    highp vec3 lightDirection;
+    float shadowBias;
+};
+
+layout(std140) uniform DrawUniforms {
+    highp mat4 viewProjectionMatrix;
+};
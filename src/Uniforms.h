@@ -0,0 +1,64 @@
+#ifndef Magnum_Examples_Shadows_Uniforms_h
+#define Magnum_Examples_Shadows_Uniforms_h
+
+#include <Magnum/Math/Matrix4.h>
+
+namespace Magnum { namespace Examples {
+
+/**
+ * @brief Uniform buffer binding points
+ *
+ * The same for every shader, so a block bound once is seen by all programs
+ * declaring it.
+ */
+enum: UnsignedInt {
+    FrameUniformBinding = 0,
+    DrawUniformBinding = 1
+};
+
+/**
+ * @brief Size of the cascade arrays in @ref FrameUniforms
+ *
+ * Fixed, so receiver shaders with any level count and shadow mode share a
+ * single frame block. Also the most levels @ref ShadowsScene allows.
+ */
+constexpr const Int MaxShadowMapLevels = 8;
+
+/**
+ * @brief Data changing once per frame
+ *
+ * Same std140 layout as the `FrameUniforms` block in `Uniforms.glsl`.
+ */
+struct FrameUniforms {
+    /**
+     * @brief World space -> shadow map texture space, per cascade
+     *
+     * The atlas for @ref ShadowMode::Hard, the cascade's moments layer for
+     * @ref ShadowMode::Variance.
+     */
+    Matrix4 shadowmapMatrices[MaxShadowMapLevels];
+
+    /** @brief Rectangle of each cascade in the texture, see @ref ShadowLight::layerRects() */
+    Vector4 shadowmapRects[MaxShadowMapLevels];
+
+    /* The bias fills the vec3 up to a vec4, as std140 does too */
+    Vector3 lightDirection;
+    Float shadowBias;
+};
+
+/**
+ * @brief Data changing with each pass
+ *
+ * Same std140 layout as the `DrawUniforms` block in `Uniforms.glsl`. The
+ * model matrix comes per instance.
+ */
+struct DrawUniforms {
+    Matrix4 viewProjectionMatrix;
+};
+
+static_assert(sizeof(FrameUniforms) == MaxShadowMapLevels*(64 + 16) + 16,
+    "FrameUniforms doesn't match the std140 layout");
+
+}}
+
+#endif